@@ -10,7 +10,7 @@
 
 /*include*/
 #if (EPICS_VERSION>=3 && EPICS_REVISION>=14) || EPICS_VERSION >= 7
-
+        #include <epicsTime.h>
 #else
         #include "vxWorks.h"
         #include "semLib.h"
@@ -19,6 +19,9 @@
 #define	TWO_CHANNEL_SCOPE	2
 #define	FOUR_CHANNEL_SCOPE	4  
 
+/* channel number 1~8 map to C1,C2,C3,C4,TA,TB,TC,TD, see LeCroy_Read_Multi */
+#define	TOTALCHNLS	8
+
 /* Link Status  **/
 #define	LINK_DOWN		0
 #define	LINK_OK			1
@@ -57,8 +60,17 @@
 #define	ENABLEACAL	17
 #define	DISABLEACAL	18
 #define	GETACALSTAT	19
+#define	SETFORMAT	20	/* LECROY_FMT_BYTE or LECROY_FMT_WORD, see LeCroy_Set_Format */
+#define	GETFORMAT	21
+#define	ENABLESRQ	22	/* service request on new acquisition, see LeCroy_Wait_Srq */
+#define	DISABLESRQ	23
+#define	GETSRQSTAT	24
 /* To support new_command, you have to add new definition above */
 
+/* waveform transfer format, value is bytes per sample, same as in LeCroy_drv.h */
+#define	LECROY_FMT_BYTE		1	/* 8 bits, default */
+#define	LECROY_FMT_WORD		2	/* up to 16 bits, for scopes with more than 8 bits resolution */
+
 /** for chnlstat readback */
 #define	OFF	0
 #define	ON	1
@@ -112,6 +124,90 @@ static struct TRIG_MODE
 
 typedef struct LECROY	* LeCroyID;
 
+/* LeCroy_Read_Raw tells caller how to convert raw samples, same as in LeCroy_drv.h */
+#define	ACQSTAMPSIZE	20
+typedef struct LECROY_WFINFO
+{
+	int	samplesize;	/* 1 for BYTE, 2 for WORD, see COMM_TYPE */
+	int	points;		/* how many valid points are in raw buffer */
+	float	gain;		/* VERTICAL_GAIN */
+	float	offset;		/* VERTICAL_OFFSET */
+	double	t0;		/* seconds from trigger to first point, FIRST_POINT counted in */
+	double	dt;		/* seconds between points, SPARSING_FACTOR counted in */
+	unsigned char	acqstamp[ACQSTAMPSIZE];	/* TRIGGER_TIME and SWEEP_PER_ACQ, tells acquisitions apart */
+	unsigned int	setup;	/* wfsetup of scope when read, see LeCroy_Read_Multi */
+	epicsTimeStamp	trgtime;	/* TRIGGER_TIME plus offset of LeCroy_Set_TrgOffset */
+	int	segments;	/* segments in raw buffer, 1 unless LeCroy_Read_Seg read a sequence */
+	int	segpoints;	/* points of each of them */
+	int	points2;	/* valid points of WAVE_ARRAY_2, if LeCroy_Read_Arrays asked for it */
+}	LECROY_WFINFO;
+
+/* one entry of TRIGTIME_ARRAY of a sequence, same as in LeCroy_drv.h */
+typedef struct LECROY_SEGTIME
+{
+	double	trgtime;	/* seconds from trigger of first segment */
+	double	trgoffset;	/* seconds from trigger to first point of this segment */
+}	LECROY_SEGTIME;
+
+/* LeCroy_Convert_Stat works these out in the same pass as volts, same as in LeCroy_drv.h */
+typedef struct LECROY_WFSTAT
+{
+	double	min;		/* volts */
+	double	max;		/* volts */
+	double	mean;		/* volts */
+	double	rms;		/* volts */
+	double	area;		/* volt seconds, sum of points times dt */
+	int	peak;		/* point of largest magnitude, first one */
+	int	points;		/* they come from */
+}	LECROY_WFSTAT;
+
+/* what LeCroy_Read_Arrays keeps beside WAVE_ARRAY_1, same as in LeCroy_drv.h */
+typedef struct LECROY_ARRAYS
+{
+	int	seq;		/* TRUE to read all segments of a sequence, like LeCroy_Read_Seg */
+	LECROY_SEGTIME	*psegtime;	/* TRIGTIME_ARRAY goes here if not NULL */
+	int	maxseg;		/* up to this many entries */
+	double	*prisoffset;	/* RIS_TIME_ARRAY goes here if not NULL, seconds of each RIS segment */
+	int	maxris;		/* up to this many entries */
+	int	ris;		/* returns entries of RIS_TIME_ARRAY kept */
+	void	*praw2;		/* WAVE_ARRAY_2 goes here if not NULL, same sample size as praw */
+	int	pts2;		/* up to this many samples */
+	int	points2;	/* returns samples of WAVE_ARRAY_2 kept */
+}	LECROY_ARRAYS;
+
+/* WFSU of one channel, LeCroy_Set_Wfsu keeps it, same as in LeCroy_drv.h */
+#define	WFSU_AUTO	-1
+typedef struct LECROY_WFSU
+{
+	int	sparsing;	/* SP, 0 means every point, WFSU_AUTO means pts points cover whole trace */
+	int	npoints;	/* NP, 0 means all, WFSU_AUTO means pts of the read */
+	int	firstpoint;	/* FP */
+}	LECROY_WFSU;
+
+/* traffic counters, LeCroy_Get_Stats copies them, same as in LeCroy_drv.h */
+typedef struct LECROY_STATS
+{
+	unsigned int	waveforms;	/* waveforms read */
+	double		wfbytes;	/* bytes of WAVE_ARRAY_1 in them, twice as much for WORD */
+	double		rxbytes;	/* all bytes from socket, headers and descriptors included */
+	unsigned int	checks;		/* channels asked for WF? DESC before transfer */
+	unsigned int	skipped;	/* of them, transfers saved because scope had nothing new */
+	unsigned int	srqs;		/* service requests, one for each new acquisition */
+}	LECROY_STATS;
+
+/* LeCroy_Get_Status fills all of it with one query, same as in LeCroy_drv.h */
+#define	STATUS_CHNLS	4	/* C1~C4, a two channels scope only fills first two */
+typedef struct LECROY_STATUS
+{
+	int	chanstat[STATUS_CHNLS];	/* ON or OFF, as GETCHANSTAT */
+	float	voltdiv[STATUS_CHNLS];	/* as GETVOLTDIV */
+	int	memsize;		/* as GETMEMSIZE */
+	float	timediv;		/* as GETTIMEDIV */
+	int	trgmode;		/* as GETTRGMODE */
+	int	trgsrc;			/* as GETTRGSRC */
+	int	acalstat;		/* ON or OFF, as GETACALSTAT */
+}	LECROY_STATUS;
+
 /* to add new_function, add prototype below */
 
 /** This function should be called only once for one scope **/
@@ -135,9 +231,101 @@ STATUS	LeCroy_Get_IPAddr(LeCroyID lecroyid, char * ipaddr);
 /* chnl is 1~8 */
 int LeCroy_Read(LeCroyID lecroyid, int chnl, float *pwaveform, int pts);
 
+/* chnl is 1~8, praw must come from LeCroy_Malloc_Raw(pts) and hold pts samples */
+/* samples are received right into praw, use LeCroy_Convert to get volts */
+int LeCroy_Read_Raw(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_WFINFO *pinfo);
+
+/* bit 0~7 of chnlmask is channel 1~8, arrays are indexed by channel 1~8 as 0~7 */
+/* all channels come from one compound WF? query and so from one trigger, */
+/* return mask of channels read, disabled channels are left out.          */
+/* If psame is not NULL, channels in *psame have their last read in praw  */
+/* and pinfo, they are checked with WF? DESC first and only transferred   */
+/* when scope has a new acquisition. *psame returns channels left alone.  */
+int LeCroy_Read_Multi(LeCroyID lecroyid, unsigned int chnlmask, void *praw[], const int pts[], LECROY_WFINFO pinfo[], unsigned int *psame);
+
+/* chnl is 1~8, scope in sequence mode sends all segments with one WF?, they */
+/* go back to back into praw, whole segments up to pts samples. If psegtime  */
+/* is not NULL, it gets TRIGTIME_ARRAY of up to maxseg of them. Return number */
+/* of points, pinfo->segments and segpoints say how they split up. Without   */
+/* sequence mode it is one segment, like LeCroy_Read_Raw                     */
+int LeCroy_Read_Seg(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_SEGTIME *psegtime, int maxseg, LECROY_WFINFO *pinfo);
+
+/* chnl is 1~8, same as LeCroy_Read_Raw or LeCroy_Read_Seg (parrays->seq),  */
+/* but also keeps TRIGTIME_ARRAY, RIS_TIME_ARRAY and WAVE_ARRAY_2 if parrays */
+/* asks for them, like minimum of extrema or imaginary part of FFT math. */
+/* parrays->ris and points2 return how many entries of them were kept   */
+int LeCroy_Read_Arrays(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_ARRAYS *parrays, LECROY_WFINFO *pinfo);
+
+/* convert pts raw samples described by pinfo to volts */
+int LeCroy_Convert(const LECROY_WFINFO *pinfo, const void *praw, float *pwaveform, int pts);
+
+/* same as LeCroy_Convert, and fills *pstat in the same pass over praw. */
+/* pwaveform can be NULL for statistics only                           */
+int LeCroy_Convert_Stat(const LECROY_WFINFO *pinfo, const void *praw, float *pwaveform, int pts, LECROY_WFSTAT *pstat);
+
+/* volts of pts points from first added up, return how many */
+int LeCroy_Sum(const LECROY_WFINFO *pinfo, const void *praw, int first, int pts, double *psum);
+
+/* time axis of pts points described by pinfo, seconds from trigger */
+int LeCroy_Time_Axis(const LECROY_WFINFO *pinfo, double *ptime, int pts);
+
+/* copy pts raw samples described by pinfo as they are, dstsamplesize is 1 or 2, */
+/* volts are sample * pinfo->gain - pinfo->offset */
+int LeCroy_Copy_Raw(const LECROY_WFINFO *pinfo, const void *praw, void *pdst, int dstsamplesize, int pts);
+
+/* format is LECROY_FMT_BYTE or LECROY_FMT_WORD, it is kept over link recovery, */
+/* if link is down now it is sent when link comes back                        */
+STATUS	LeCroy_Set_Format(LeCroyID lecroyid, int format);
+
+/* chnl is 1~8, WFSU goes out in front of WF? of this channel when it changes, */
+/* so scope only sends points we keep. Default is every point, NP WFSU_AUTO.  */
+/* SP WFSU_AUTO comes from WAVEDESC of last read, a read whose WAVEDESC says */
+/* trace changed, like first one or after TIMEDIVS, is done again right away */
+STATUS	LeCroy_Set_Wfsu(LeCroyID lecroyid, int chnl, const LECROY_WFSU * pwfsu);
+STATUS	LeCroy_Get_Wfsu(LeCroyID lecroyid, int chnl, LECROY_WFSU * pwfsu);
+
+/* block until scope asks for service after a new acquisition, ENABLESRQ */
+/* with LeCroy_Ioctl first. Return ERROR if timeout (seconds) expires,    */
+/* timeout 0 only looks once without waiting                              */
+STATUS	LeCroy_Wait_Srq(LeCroyID lecroyid, double timeout);
+
+/* for one thread that watches many scopes instead of LeCroy_Wait_Srq on */
+/* each. *pfd is socket to select on, ERROR if SRQ is off or link down.  */
+/* *ptaken is TRUE when a transaction already took the SRQ, then socket  */
+/* may stay quiet. Either way LeCroy_Wait_Srq with timeout 0 gets it     */
+STATUS	LeCroy_Get_SrqFd(LeCroyID lecroyid, int * pfd, BOOL * ptaken);
+
+/* scope clock is not IOC clock, offset (seconds) is added to TRIGGER_TIME */
+/* before it goes into LECROY_WFINFO trgtime, default is 0               */
+STATUS	LeCroy_Set_TrgOffset(LeCroyID lecroyid, double offset);
+STATUS	LeCroy_Get_TrgOffset(LeCroyID lecroyid, double * poffset);
+
+/* copy of traffic counters */
+STATUS	LeCroy_Get_Stats(LeCroyID lecroyid, LECROY_STATS * pstats);
+
+/* name of conversion kernels LeCroy_Convert uses on this CPU, like "avx2" */
+const char *	LeCroy_Conv_Name(void);
+
+/* how many workers help converting long waveforms, 0 if callers do them alone */
+int	LeCroy_Conv_Workers(void);
+
+/* cores of this host, 1 if we can't tell */
+int	LeCroy_Conv_CPUs(void);
+
+/* time conversion kernels this CPU can run, 0 for default pts and loops */
+void	LeCroy_Conv_Bench(int pts, int loops);
+
+/* aligned raw buffer big enough for pts samples of any format */
+void *	LeCroy_Malloc_Raw(int pts);
+void	LeCroy_Free_Raw(void *praw);
+
 /* chnl number 0 is used for non-channel related operation */
 STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg);
 
+/* channel status, volt/div, memory size, time/div, trigger mode, trigger source */
+/* and auto calibration all at once, it costs one round trip to scope */
+STATUS	LeCroy_Get_Status(LeCroyID lecroyid, LECROY_STATUS * pstatus);
+
 /* time should be a char array equal or bigger than 31 bytes */
 STATUS	LeCroy_Get_LastTrgTime(LeCroyID lecroyid, int chnl, char * time);
 
@@ -0,0 +1,749 @@
+/**********************************************************************************/
+/**  Description: Raw sample to volts conversion kernels for LeCroy driver       **/
+/**********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsEvent.h>
+#include <epicsMessageQueue.h>
+#include <epicsVersion.h>
+#include <epicsStdio.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "LeCroy_conv.h"
+
+/* x86 kernels need gcc or clang, they are built with target attribute, so */
+/* rest of IOC is still built for baseline CPU and runs everywhere          */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define	LECROY_CONV_X86
+#include <immintrin.h>
+#endif
+
+/* compilers would fuse multiply and subtract into FMA with AVX-512, that rounds */
+/* once instead of twice and gives slightly different volts than plain C kernel  */
+#ifdef	LECROY_CONV_X86
+#ifdef	__clang__
+/* clang contracts by default, even without -ffp-contract, for whole file here */
+#pragma STDC FP_CONTRACT OFF
+#define	LECROY_TARGET(isa)	__attribute__ ((target (isa)))
+#else
+#define	LECROY_TARGET(isa)	__attribute__ ((target (isa), optimize ("fp-contract=off")))
+#endif
+#endif
+
+LECROY_CONV_FUNC	LeCroy_Conv_Byte=NULL;
+LECROY_CONV_FUNC	LeCroy_Conv_Word=NULL;
+LECROY_STAT_FUNC	LeCroy_Stat_Byte=NULL;
+LECROY_STAT_FUNC	LeCroy_Stat_Word=NULL;
+static const char	* pConvName="none";
+
+/* one piece of a long waveform for a pool worker, see LeCroy_Conv_Stat */
+typedef struct LECROY_CONV_JOB
+{
+	const void	* praw;
+	int		samplesize;
+	float		* pwaveform;	/* NULL for statistics only */
+	int		pts;
+	float		gain;
+	float		offset;
+	LECROY_CONV_STAT	* pstat;	/* NULL for conversion only */
+	LECROY_CONV_STAT	stat;
+	epicsEventId	done;		/* worker signals it when piece is done */
+}	LECROY_CONV_JOB;
+
+/* workers shared by all scopes, each takes pieces from poolQID */
+static epicsMessageQueueId	poolQID=NULL;
+static int			poolWorkers=0;
+
+/* completion events of a calling thread, made on its first long waveform */
+/* and kept, so LeCroy_Conv_Stat allocates nothing after that             */
+typedef struct LECROY_CONV_EVENTS
+{
+	epicsEventId	done[LECROY_CONV_WORKERS];	/* one per piece besides first */
+}	LECROY_CONV_EVENTS;
+static epicsThreadPrivateId	convEvents=NULL;
+
+/********************************  plain C  ***************************************/
+static void LeCroy_Conv_Byte_C(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	int			cploop;
+
+	for(cploop=0;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataB[cploop]*gain-offset;
+}
+
+static void LeCroy_Conv_Word_C(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	int			cploop;
+
+	for(cploop=0;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataW[cploop]*gain-offset;
+}
+
+static void LeCroy_Stat_Byte_C(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	int			cploop, min=127, max=-128, sum=0, sumsq=0;
+
+	/* a block of bytes can't overflow int */
+	for(cploop=0;cploop<pts;cploop++)
+	{
+		if(pWaveDataB[cploop]<min)	min=pWaveDataB[cploop];
+		if(pWaveDataB[cploop]>max)	max=pWaveDataB[cploop];
+		sum+=pWaveDataB[cploop];
+		sumsq+=pWaveDataB[cploop]*pWaveDataB[cploop];
+	}
+	pstat->min=min;
+	pstat->max=max;
+	pstat->sum=sum;
+	pstat->sumsq=sumsq;
+}
+
+static void LeCroy_Stat_Word_C(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	int			cploop, min=32767, max=-32768, sum=0;
+	double			sumsq=0;
+
+	for(cploop=0;cploop<pts;cploop++)
+	{
+		if(pWaveDataW[cploop]<min)	min=pWaveDataW[cploop];
+		if(pWaveDataW[cploop]>max)	max=pWaveDataW[cploop];
+		sum+=pWaveDataW[cploop];
+		sumsq+=(double)(pWaveDataW[cploop]*pWaveDataW[cploop]);	/* exact up to 2^53 */
+	}
+	pstat->min=min;
+	pstat->max=max;
+	pstat->sum=sum;
+	pstat->sumsq=sumsq;
+}
+
+#ifdef	LECROY_CONV_X86
+/**********************************  SSE2  ****************************************/
+/* SSE2 has no sign extension, so we unpack each byte twice and shift it back */
+#define	SSE2_STORE(pdst, vint)	_mm_storeu_ps((pdst), _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(vint), vgain), voffset))
+
+static LECROY_TARGET("sse2") void LeCroy_Conv_Byte_SSE2(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	__m128			vgain=_mm_set1_ps(gain);
+	__m128			voffset=_mm_set1_ps(offset);
+	__m128i			vb, vlo, vhi;
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+	{
+		vb=_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop));
+		vlo=_mm_srai_epi16(_mm_unpacklo_epi8(vb,vb),8);	/* samples 0~7 as 16 bits */
+		vhi=_mm_srai_epi16(_mm_unpackhi_epi8(vb,vb),8);	/* samples 8~15 as 16 bits */
+		SSE2_STORE(pwaveform+cploop,    _mm_srai_epi32(_mm_unpacklo_epi16(vlo,vlo),16));
+		SSE2_STORE(pwaveform+cploop+4,  _mm_srai_epi32(_mm_unpackhi_epi16(vlo,vlo),16));
+		SSE2_STORE(pwaveform+cploop+8,  _mm_srai_epi32(_mm_unpacklo_epi16(vhi,vhi),16));
+		SSE2_STORE(pwaveform+cploop+12, _mm_srai_epi32(_mm_unpackhi_epi16(vhi,vhi),16));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataB[cploop]*gain-offset;
+}
+
+static LECROY_TARGET("sse2") void LeCroy_Conv_Word_SSE2(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	__m128			vgain=_mm_set1_ps(gain);
+	__m128			voffset=_mm_set1_ps(offset);
+	__m128i			vw;
+	int			cploop;
+
+	for(cploop=0;cploop+8<=pts;cploop+=8)
+	{
+		vw=_mm_loadu_si128((const __m128i *)(pWaveDataW+cploop));
+		SSE2_STORE(pwaveform+cploop,   _mm_srai_epi32(_mm_unpacklo_epi16(vw,vw),16));
+		SSE2_STORE(pwaveform+cploop+4, _mm_srai_epi32(_mm_unpackhi_epi16(vw,vw),16));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataW[cploop]*gain-offset;
+}
+
+/* Statistics of 16 bits samples in vw: min and max as they are, sums with */
+/* madd into 32 bits, squares with madd too. A pair of -32768 squares to   */
+/* 2^31, so we take them as unsigned and add into 64 bits                  */
+#define	SSE2_STAT(vw)	do{	__m128i	vsq;\
+				vmin=_mm_min_epi16(vmin,(vw));\
+				vmax=_mm_max_epi16(vmax,(vw));\
+				vsum=_mm_add_epi32(vsum,_mm_madd_epi16((vw),vone));\
+				vsq=_mm_madd_epi16((vw),(vw));\
+				vsumsq=_mm_add_epi64(vsumsq,_mm_unpacklo_epi32(vsq,vzero));\
+				vsumsq=_mm_add_epi64(vsumsq,_mm_unpackhi_epi32(vsq,vzero));\
+			}while(0)
+
+static LECROY_TARGET("sse2") void LeCroy_Stat_Reduce_SSE2(__m128i vmin, __m128i vmax, __m128i vsum, __m128i vsumsq, LECROY_CONV_STAT * pstat)
+{
+	short int		min[8], max[8];
+	int			sum[4];
+	unsigned long long	sumsq[2];
+	int			loop;
+
+	_mm_storeu_si128((__m128i *)min, vmin);
+	_mm_storeu_si128((__m128i *)max, vmax);
+	_mm_storeu_si128((__m128i *)sum, vsum);
+	_mm_storeu_si128((__m128i *)sumsq, vsumsq);
+	for(loop=0;loop<8;loop++)
+	{
+		if(min[loop]<pstat->min)	pstat->min=min[loop];
+		if(max[loop]>pstat->max)	pstat->max=max[loop];
+	}
+	pstat->sum+=(double)sum[0]+sum[1]+sum[2]+sum[3];
+	pstat->sumsq+=(double)sumsq[0]+(double)sumsq[1];
+}
+
+static LECROY_TARGET("sse2") void LeCroy_Stat_Byte_SSE2(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	__m128i			vmin=_mm_set1_epi16(32767), vmax=_mm_set1_epi16(-32768);
+	__m128i			vsum=_mm_setzero_si128(), vsumsq=_mm_setzero_si128();
+	__m128i			vone=_mm_set1_epi16(1), vzero=_mm_setzero_si128();
+	__m128i			vb;
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+	{
+		vb=_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop));
+		SSE2_STAT(_mm_srai_epi16(_mm_unpacklo_epi8(vb,vb),8));
+		SSE2_STAT(_mm_srai_epi16(_mm_unpackhi_epi8(vb,vb),8));
+	}
+	LeCroy_Stat_Byte_C(pWaveDataB+cploop, pts-cploop, pstat);
+	LeCroy_Stat_Reduce_SSE2(vmin, vmax, vsum, vsumsq, pstat);
+}
+
+static LECROY_TARGET("sse2") void LeCroy_Stat_Word_SSE2(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	__m128i			vmin=_mm_set1_epi16(32767), vmax=_mm_set1_epi16(-32768);
+	__m128i			vsum=_mm_setzero_si128(), vsumsq=_mm_setzero_si128();
+	__m128i			vone=_mm_set1_epi16(1), vzero=_mm_setzero_si128();
+	int			cploop;
+
+	for(cploop=0;cploop+8<=pts;cploop+=8)
+		SSE2_STAT(_mm_loadu_si128((const __m128i *)(pWaveDataW+cploop)));
+	LeCroy_Stat_Word_C(pWaveDataW+cploop, pts-cploop, pstat);
+	LeCroy_Stat_Reduce_SSE2(vmin, vmax, vsum, vsumsq, pstat);
+}
+
+/**********************************  AVX2  ****************************************/
+#define	AVX2_STORE(pdst, vint)	_mm256_storeu_ps((pdst), _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(vint), vgain), voffset))
+
+static LECROY_TARGET("avx2") void LeCroy_Conv_Byte_AVX2(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	__m256			vgain=_mm256_set1_ps(gain);
+	__m256			voffset=_mm256_set1_ps(offset);
+	__m128i			vb;
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+	{
+		vb=_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop));
+		AVX2_STORE(pwaveform+cploop,   _mm256_cvtepi8_epi32(vb));
+		AVX2_STORE(pwaveform+cploop+8, _mm256_cvtepi8_epi32(_mm_srli_si128(vb,8)));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataB[cploop]*gain-offset;
+}
+
+static LECROY_TARGET("avx2") void LeCroy_Conv_Word_AVX2(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	__m256			vgain=_mm256_set1_ps(gain);
+	__m256			voffset=_mm256_set1_ps(offset);
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+	{
+		AVX2_STORE(pwaveform+cploop,   _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(pWaveDataW+cploop))));
+		AVX2_STORE(pwaveform+cploop+8, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(pWaveDataW+cploop+8))));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataW[cploop]*gain-offset;
+}
+
+#define	AVX2_STAT(vw)	do{	__m256i	vsq;\
+				vmin=_mm256_min_epi16(vmin,(vw));\
+				vmax=_mm256_max_epi16(vmax,(vw));\
+				vsum=_mm256_add_epi32(vsum,_mm256_madd_epi16((vw),vone));\
+				vsq=_mm256_madd_epi16((vw),(vw));\
+				vsumsq=_mm256_add_epi64(vsumsq,_mm256_unpacklo_epi32(vsq,vzero));\
+				vsumsq=_mm256_add_epi64(vsumsq,_mm256_unpackhi_epi32(vsq,vzero));\
+			}while(0)
+
+/* fold 256 bits into 128 bits, then it is same as SSE2 */
+static LECROY_TARGET("avx2") void LeCroy_Stat_Reduce_AVX2(__m256i vmin, __m256i vmax, __m256i vsum, __m256i vsumsq, LECROY_CONV_STAT * pstat)
+{
+	LeCroy_Stat_Reduce_SSE2(_mm_min_epi16(_mm256_castsi256_si128(vmin),_mm256_extracti128_si256(vmin,1)),
+				_mm_max_epi16(_mm256_castsi256_si128(vmax),_mm256_extracti128_si256(vmax,1)),
+				_mm_add_epi32(_mm256_castsi256_si128(vsum),_mm256_extracti128_si256(vsum,1)),
+				_mm_add_epi64(_mm256_castsi256_si128(vsumsq),_mm256_extracti128_si256(vsumsq,1)),
+				pstat);
+}
+
+static LECROY_TARGET("avx2") void LeCroy_Stat_Byte_AVX2(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	__m256i			vmin=_mm256_set1_epi16(32767), vmax=_mm256_set1_epi16(-32768);
+	__m256i			vsum=_mm256_setzero_si256(), vsumsq=_mm256_setzero_si256();
+	__m256i			vone=_mm256_set1_epi16(1), vzero=_mm256_setzero_si256();
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+		AVX2_STAT(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop))));
+	LeCroy_Stat_Byte_C(pWaveDataB+cploop, pts-cploop, pstat);
+	LeCroy_Stat_Reduce_AVX2(vmin, vmax, vsum, vsumsq, pstat);
+}
+
+static LECROY_TARGET("avx2") void LeCroy_Stat_Word_AVX2(const void * praw, int pts, LECROY_CONV_STAT * pstat)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	__m256i			vmin=_mm256_set1_epi16(32767), vmax=_mm256_set1_epi16(-32768);
+	__m256i			vsum=_mm256_setzero_si256(), vsumsq=_mm256_setzero_si256();
+	__m256i			vone=_mm256_set1_epi16(1), vzero=_mm256_setzero_si256();
+	int			cploop;
+
+	for(cploop=0;cploop+16<=pts;cploop+=16)
+		AVX2_STAT(_mm256_loadu_si256((const __m256i *)(pWaveDataW+cploop)));
+	LeCroy_Stat_Word_C(pWaveDataW+cploop, pts-cploop, pstat);
+	LeCroy_Stat_Reduce_AVX2(vmin, vmax, vsum, vsumsq, pstat);
+}
+
+/********************************  AVX-512  ***************************************/
+#define	AVX512_STORE(pdst, vint)	_mm512_storeu_ps((pdst), _mm512_sub_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(vint), vgain), voffset))
+
+static LECROY_TARGET("avx512f") void LeCroy_Conv_Byte_AVX512(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;
+	__m512			vgain=_mm512_set1_ps(gain);
+	__m512			voffset=_mm512_set1_ps(offset);
+	int			cploop;
+
+	for(cploop=0;cploop+32<=pts;cploop+=32)
+	{
+		AVX512_STORE(pwaveform+cploop,    _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop))));
+		AVX512_STORE(pwaveform+cploop+16, _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(pWaveDataB+cploop+16))));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataB[cploop]*gain-offset;
+}
+
+static LECROY_TARGET("avx512f") void LeCroy_Conv_Word_AVX512(const void * praw, float * pwaveform, int pts, float gain, float offset)
+{
+	const signed short int	* pWaveDataW=(const signed short int *)praw;
+	__m512			vgain=_mm512_set1_ps(gain);
+	__m512			voffset=_mm512_set1_ps(offset);
+	int			cploop;
+
+	for(cploop=0;cploop+32<=pts;cploop+=32)
+	{
+		AVX512_STORE(pwaveform+cploop,    _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(pWaveDataW+cploop))));
+		AVX512_STORE(pwaveform+cploop+16, _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(pWaveDataW+cploop+16))));
+	}
+	for(;cploop<pts;cploop++)
+		pwaveform[cploop]=pWaveDataW[cploop]*gain-offset;
+}
+#endif	/* LECROY_CONV_X86 */
+
+/* from slowest to fastest, 16 bits integer math of AVX-512 needs AVX512BW, */
+/* so AVX-512 CPUs take statistics kernels of AVX2, they all have it        */
+static struct LECROY_CONV_KERNEL
+{
+	const char		* name;
+	const char		* cpufeature;	/* for __builtin_cpu_supports, NULL means any CPU */
+	LECROY_CONV_FUNC	byte;
+	LECROY_CONV_FUNC	word;
+	LECROY_STAT_FUNC	statbyte;
+	LECROY_STAT_FUNC	statword;
+}	conv_kernel[]={	{"C",		NULL,		LeCroy_Conv_Byte_C,		LeCroy_Conv_Word_C,	LeCroy_Stat_Byte_C,	LeCroy_Stat_Word_C},
+#ifdef	LECROY_CONV_X86
+			{"sse2",	"sse2",		LeCroy_Conv_Byte_SSE2,		LeCroy_Conv_Word_SSE2,	LeCroy_Stat_Byte_SSE2,	LeCroy_Stat_Word_SSE2},
+			{"avx2",	"avx2",		LeCroy_Conv_Byte_AVX2,		LeCroy_Conv_Word_AVX2,	LeCroy_Stat_Byte_AVX2,	LeCroy_Stat_Word_AVX2},
+			{"avx512",	"avx512f",	LeCroy_Conv_Byte_AVX512,	LeCroy_Conv_Word_AVX512,	LeCroy_Stat_Byte_AVX2,	LeCroy_Stat_Word_AVX2},
+#endif
+		};
+#define	CONV_KERNELS	(sizeof(conv_kernel)/sizeof(conv_kernel[0]))
+
+static int LeCroy_Conv_Supported(int kernel)
+{
+	if(conv_kernel[kernel].cpufeature==NULL)	return 1;
+#ifdef	LECROY_CONV_X86
+	/* __builtin_cpu_supports only takes string literal */
+	if(strcmp(conv_kernel[kernel].cpufeature,"sse2")==0)	return __builtin_cpu_supports("sse2");
+	if(strcmp(conv_kernel[kernel].cpufeature,"avx2")==0)	return __builtin_cpu_supports("avx2");
+	if(strcmp(conv_kernel[kernel].cpufeature,"avx512f")==0)	return __builtin_cpu_supports("avx512f");
+#endif
+	return 0;
+}
+
+static void LeCroy_Conv_Piece(LECROY_CONV_JOB * pjob);
+
+/* pieces wait here until a worker is free, caller does it itself if full */
+static void LeCroy_Conv_Worker(void * parg)
+{
+	LECROY_CONV_JOB	* pjob;
+
+	while(1)
+	{
+		if(epicsMessageQueueReceive(poolQID, &pjob, sizeof(pjob))!=sizeof(pjob))	continue;
+		LeCroy_Conv_Piece(pjob);
+		epicsEventSignal(pjob->done);
+	}
+}
+
+/* cores of this host, 1 if we can't tell */
+int	LeCroy_Conv_CPUs(void)
+{
+	int	cpus=1;
+
+#if defined(EPICS_VERSION_INT) && defined(VERSION_INT)
+#if EPICS_VERSION_INT >= VERSION_INT(3,15,0,2)
+#define	LECROY_CONV_GETCPUS
+#endif
+#endif
+#if defined(LECROY_CONV_GETCPUS)
+	cpus=epicsThreadGetCPUs();
+#elif defined(_SC_NPROCESSORS_ONLN)
+	cpus=(int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return	(cpus>1)?cpus:1;
+}
+
+/* caller of LeCroy_Conv_Stat works on one piece too, so one worker less */
+/* than cores, none on a single core host                                */
+static void LeCroy_Conv_Pool(void)
+{
+	int	workers=LeCroy_Conv_CPUs()-1;
+	char	name[24];
+
+	if(workers>LECROY_CONV_WORKERS)	workers=LECROY_CONV_WORKERS;
+	if(workers<=0)	return;
+
+	poolQID=epicsMessageQueueCreate(LECROY_CONV_QUEUE, sizeof(LECROY_CONV_JOB *));
+	convEvents=epicsThreadPrivateCreate();
+	if(poolQID==NULL || convEvents==NULL)
+	{
+		printf("Fail to create queue for LeCroy conversion workers, converting in one thread!\n");
+		return;
+	}
+	for(poolWorkers=0;poolWorkers<workers;poolWorkers++)
+	{
+		epicsSnprintf(name, sizeof(name), "tScopeConv%d", poolWorkers);
+		if(epicsThreadCreate(name, epicsThreadPriorityScanHigh, epicsThreadGetStackSize(epicsThreadStackSmall), LeCroy_Conv_Worker, NULL)==NULL)
+			break;
+	}
+}
+
+static epicsThreadOnceId	convOnce=EPICS_THREAD_ONCE_INIT;
+
+static void LeCroy_Conv_Select(void * parg)
+{
+	int	kernel, best=0;
+
+#ifdef	LECROY_CONV_X86
+	__builtin_cpu_init();
+#endif
+	for(kernel=1;kernel<(int)CONV_KERNELS;kernel++)
+	{
+		if(LeCroy_Conv_Supported(kernel))	best=kernel;
+	}
+	pConvName=conv_kernel[best].name;
+	LeCroy_Conv_Word=conv_kernel[best].word;
+	LeCroy_Conv_Byte=conv_kernel[best].byte;
+	LeCroy_Stat_Word=conv_kernel[best].statword;
+	LeCroy_Stat_Byte=conv_kernel[best].statbyte;
+	LeCroy_Conv_Pool();
+}
+
+void	LeCroy_Conv_Init(void)
+{
+	epicsThreadOnce(&convOnce, LeCroy_Conv_Select, NULL);
+}
+
+/* first point of value in a block, we know it is there */
+static int LeCroy_Conv_Find(const void * praw, int samplesize, int pts, int value)
+{
+	int	cploop;
+
+	for(cploop=0;cploop<pts-1;cploop++)
+	{
+		if(((samplesize==1)?((const signed char *)praw)[cploop]:((const signed short int *)praw)[cploop])==value)
+			break;
+	}
+	return	cploop;
+}
+
+/* events of calling thread, NULL if we can't make them, then it converts alone */
+static LECROY_CONV_EVENTS * LeCroy_Conv_Events(void)
+{
+	LECROY_CONV_EVENTS	* pevents=(LECROY_CONV_EVENTS *)epicsThreadPrivateGet(convEvents);
+	int			loop;
+
+	if(pevents!=NULL)	return pevents;
+
+	pevents=(LECROY_CONV_EVENTS *)calloc(1, sizeof(LECROY_CONV_EVENTS));
+	if(pevents==NULL)	return NULL;
+	for(loop=0;loop<poolWorkers;loop++)
+	{
+		pevents->done[loop]=epicsEventCreate(epicsEventEmpty);
+		if(pevents->done[loop]==NULL)
+		{
+			while(--loop>=0)	epicsEventDestroy(pevents->done[loop]);
+			free(pevents);
+			return NULL;
+		}
+	}
+	epicsThreadPrivateSet(convEvents, pevents);
+	return pevents;
+}
+
+/* one piece in this thread, block by block while it is still in cache */
+static void LeCroy_Conv_Piece(LECROY_CONV_JOB * pjob)
+{
+	LECROY_CONV_FUNC	conv;
+	LECROY_STAT_FUNC	stat;
+	LECROY_CONV_STAT	block, * pstat=pjob->pstat;
+	const char		* pblock;
+	int			start, size;
+
+	conv=(pjob->samplesize==1)?LeCroy_Conv_Byte:LeCroy_Conv_Word;
+	stat=(pjob->samplesize==1)?LeCroy_Stat_Byte:LeCroy_Stat_Word;
+
+	if(pstat==NULL)
+	{/* nothing to keep in cache for */
+		if(pjob->pwaveform)	conv(pjob->praw, pjob->pwaveform, pjob->pts, pjob->gain, pjob->offset);
+		return;
+	}
+
+	pstat->sum=0;
+	pstat->sumsq=0;
+	for(start=0;start<pjob->pts;start+=LECROY_CONV_BLOCK)
+	{
+		size=(pjob->pts-start<LECROY_CONV_BLOCK)?(pjob->pts-start):LECROY_CONV_BLOCK;
+		pblock=(const char *)pjob->praw+start*pjob->samplesize;
+		if(pjob->pwaveform)	conv(pblock, pjob->pwaveform+start, size, pjob->gain, pjob->offset);
+		stat(pblock, size, &block);
+		/* block is in cache, looking up a new extreme again is cheap */
+		if(start==0 || block.min<pstat->min)
+		{
+			pstat->min=block.min;
+			pstat->minindex=start+LeCroy_Conv_Find(pblock, pjob->samplesize, size, block.min);
+		}
+		if(start==0 || block.max>pstat->max)
+		{
+			pstat->max=block.max;
+			pstat->maxindex=start+LeCroy_Conv_Find(pblock, pjob->samplesize, size, block.max);
+		}
+		pstat->sum+=block.sum;
+		pstat->sumsq+=block.sumsq;
+	}
+}
+
+void	LeCroy_Conv_Stat(const void * praw, int samplesize, float * pwaveform, int pts, float gain, float offset, LECROY_CONV_STAT * pstat)
+{
+	LECROY_CONV_JOB	job[LECROY_CONV_WORKERS+1], * pjob;
+	LECROY_CONV_EVENTS	* pevents=NULL;
+	int		pieces, piece, size, start;
+
+	LeCroy_Conv_Init();
+
+	/* long enough for each piece to be worth a thread switch? */
+	pieces=(poolWorkers>0)?pts/LECROY_CONV_PIECE:1;
+	if(pieces>poolWorkers+1)	pieces=poolWorkers+1;
+	if(pieces>1)	pevents=LeCroy_Conv_Events();
+	if(pieces<1 || pevents==NULL)	pieces=1;
+	/* whole blocks per piece, so they start aligned like praw */
+	size=((pts+pieces-1)/pieces+LECROY_CONV_BLOCK-1)/LECROY_CONV_BLOCK*LECROY_CONV_BLOCK;
+
+	for(piece=0,start=0;piece<pieces;piece++,start+=size)
+	{
+		pjob=&job[piece];
+		pjob->praw=(const char *)praw+start*samplesize;
+		pjob->samplesize=samplesize;
+		pjob->pwaveform=pwaveform?pwaveform+start:NULL;
+		pjob->pts=(pts-start<size)?(pts-start):size;
+		pjob->gain=gain;
+		pjob->offset=offset;
+		pjob->pstat=(pieces==1)?pstat:(pstat?&pjob->stat:NULL);
+		pjob->done=NULL;
+		/* first piece is ours, others go to workers if they can take them */
+		if(piece==0)	continue;
+		pjob->done=pevents->done[piece-1];
+		if(epicsMessageQueueTrySend(poolQID, &pjob, sizeof(pjob))!=0)
+			pjob->done=NULL;
+	}
+
+	for(piece=0;piece<pieces;piece++)
+	{
+		pjob=&job[piece];
+		if(pjob->done==NULL)	LeCroy_Conv_Piece(pjob);
+	}
+
+	for(piece=0,start=0;piece<pieces;piece++,start+=size)
+	{
+		pjob=&job[piece];
+		if(pjob->done!=NULL)
+			epicsEventWait(pjob->done);	/* empty again for next call */
+		if(pstat==NULL || pieces==1)	continue;
+		/* in order, so first point of an extreme wins like in one piece */
+		if(piece==0 || pjob->stat.min<pstat->min)
+		{
+			pstat->min=pjob->stat.min;
+			pstat->minindex=start+pjob->stat.minindex;
+		}
+		if(piece==0 || pjob->stat.max>pstat->max)
+		{
+			pstat->max=pjob->stat.max;
+			pstat->maxindex=start+pjob->stat.maxindex;
+		}
+		pstat->sum=(piece==0)?pjob->stat.sum:pstat->sum+pjob->stat.sum;
+		pstat->sumsq=(piece==0)?pjob->stat.sumsq:pstat->sumsq+pjob->stat.sumsq;
+	}
+}
+
+/* how many workers convert long waveforms besides caller, 0 for none */
+int	LeCroy_Conv_Workers(void)
+{
+	LeCroy_Conv_Init();
+	return	poolWorkers;
+}
+
+const char *	LeCroy_Conv_Name(void)
+{
+	LeCroy_Conv_Init();
+	return	pConvName;
+}
+
+/* statistics of pts samples with one kernel, block by block, no indices */
+static void LeCroy_Conv_Bench_Stat(LECROY_STAT_FUNC stat, const void * praw, int samplesize, int pts, LECROY_CONV_STAT * pstat)
+{
+	LECROY_CONV_STAT	block;
+	int			start, size;
+
+	pstat->min=32767;
+	pstat->max=-32768;
+	pstat->sum=0;
+	pstat->sumsq=0;
+	for(start=0;start<pts;start+=LECROY_CONV_BLOCK)
+	{
+		size=(pts-start<LECROY_CONV_BLOCK)?(pts-start):LECROY_CONV_BLOCK;
+		stat((const char *)praw+start*samplesize, size, &block);
+		if(block.min<pstat->min)	pstat->min=block.min;
+		if(block.max>pstat->max)	pstat->max=block.max;
+		pstat->sum+=block.sum;
+		pstat->sumsq+=block.sumsq;
+	}
+}
+
+/* Microbenchmark, convert pts samples loops times with every kernel this CPU */
+/* can run, print speed and check each one gives same volts as plain C kernel */
+/* and same statistics                                                      */
+void	LeCroy_Conv_Bench(int pts, int loops)
+{
+	char		* pmem;
+	signed char	* praw;		/* same buffer for BYTE and WORD samples */
+	float		* pref, * pout;
+	epicsTimeStamp	start, end;
+	double		seconds, refseconds[2]={0,0}, refstatseconds[2]={0,0};
+	LECROY_CONV_STAT	refstat={0}, outstat;	/* C kernel of each size fills refstat first */
+	int		kernel, size, loop, cploop;
+	const float	gain=0.0123f, offset=0.456f;
+
+	if(pts<=0)	pts=10000000;
+	if(loops<=0)	loops=10;
+
+	LeCroy_Conv_Init();
+
+	/* raw buffer aligned like LeCroy_Malloc_Raw gives, float buffers as malloc gives */
+	pmem=(char *)malloc(pts*sizeof(short int)+64);
+	pref=(float *)malloc(pts*sizeof(float));
+	pout=(float *)malloc(pts*sizeof(float));
+	if(pmem==NULL || pref==NULL || pout==NULL)
+	{
+		printf("Fail to malloc %d points for LeCroy_Conv_Bench!\n", pts);
+		free(pmem);
+		free(pref);
+		free(pout);
+		return;
+	}
+	praw=(signed char *)(((unsigned long)pmem+63)&~63UL);
+	srand(1);
+	for(cploop=0;cploop<pts*(int)sizeof(short int);cploop++)
+		praw[cploop]=(signed char)(rand()&0xFF);
+
+	printf("Converting %d points %d times, LeCroy_Convert uses \"%s\"\n", pts, loops, pConvName);
+	for(size=1;size<=2;size++)
+	{
+		for(kernel=0;kernel<(int)CONV_KERNELS;kernel++)
+		{
+			LECROY_CONV_FUNC	func=(size==1)?conv_kernel[kernel].byte:conv_kernel[kernel].word;
+			LECROY_STAT_FUNC	stat;
+
+			if(!LeCroy_Conv_Supported(kernel))
+			{
+				printf("  %s %-7s not supported by this CPU\n", (size==1)?"BYTE":"WORD", conv_kernel[kernel].name);
+				continue;
+			}
+
+			func(praw, pout, pts, gain, offset);	/* warm up cache and page in */
+			epicsTimeGetCurrent(&start);
+			for(loop=0;loop<loops;loop++)
+				func(praw, pout, pts, gain, offset);
+			epicsTimeGetCurrent(&end);
+			seconds=epicsTimeDiffInSeconds(&end, &start);
+			if(seconds<=0)	seconds=1e-9;
+
+			if(kernel==0)
+			{
+				refseconds[size-1]=seconds;
+				memcpy(pref, pout, pts*sizeof(float));
+			}
+			printf("  %s %-7s %9.1f Msamples/s  x%5.2f  %s\n", (size==1)?"BYTE":"WORD", conv_kernel[kernel].name,
+				(double)pts*loops/seconds/1e6, refseconds[size-1]/seconds,
+				memcmp(pref, pout, pts*sizeof(float))==0?"same as C":"DIFFERENT FROM C");
+
+			stat=(size==1)?conv_kernel[kernel].statbyte:conv_kernel[kernel].statword;
+			epicsTimeGetCurrent(&start);
+			for(loop=0;loop<loops;loop++)
+				LeCroy_Conv_Bench_Stat(stat, praw, size, pts, &outstat);
+			epicsTimeGetCurrent(&end);
+			seconds=epicsTimeDiffInSeconds(&end, &start);
+			if(seconds<=0)	seconds=1e-9;
+
+			if(kernel==0)
+			{
+				refstatseconds[size-1]=seconds;
+				refstat=outstat;
+			}
+			printf("  %s %-7s %9.1f Msamples/s  x%5.2f  %s, statistics\n", (size==1)?"BYTE":"WORD", conv_kernel[kernel].name,
+				(double)pts*loops/seconds/1e6, refstatseconds[size-1]/seconds,
+				(outstat.min==refstat.min && outstat.max==refstat.max && outstat.sum==refstat.sum && outstat.sumsq==refstat.sumsq)?"same as C":"DIFFERENT FROM C");
+		}
+
+		/* what records get, kernels we picked split over the workers */
+		epicsTimeGetCurrent(&start);
+		for(loop=0;loop<loops;loop++)
+			LeCroy_Conv_Stat(praw, size, pout, pts, gain, offset, &outstat);
+		epicsTimeGetCurrent(&end);
+		seconds=epicsTimeDiffInSeconds(&end, &start);
+		if(seconds<=0)	seconds=1e-9;
+		printf("  %s %-7s %9.1f Msamples/s  x%5.2f  %s, converted with statistics, %d workers\n", (size==1)?"BYTE":"WORD", "pool",
+			(double)pts*loops/seconds/1e6, refseconds[size-1]/seconds,
+			(memcmp(pref, pout, pts*sizeof(float))==0 && outstat.min==refstat.min && outstat.max==refstat.max && outstat.sum==refstat.sum && outstat.sumsq==refstat.sumsq)?"same as C":"DIFFERENT FROM C",
+			poolWorkers);
+	}
+
+	free(pmem);
+	free(pref);
+	free(pout);
+}
@@ -0,0 +1,82 @@
+/**********************************************************************************/
+/**  Description: Raw sample to volts conversion kernels for LeCroy driver       **/
+/**********************************************************************************/
+
+/**********************************************************************************/
+/* Description:                                                                   */
+/*                                                                                */
+/* volts = sample * VERTICAL_GAIN - VERTICAL_OFFSET, for signed 8 bits (BYTE) or  */
+/* signed 16 bits (WORD) samples. There is a plain C kernel for any platform and  */
+/* SSE2, AVX2 and AVX-512 kernels for x86 built with gcc or clang. The best one   */
+/* this CPU can run is picked once by LeCroy_Conv_Init, all of them give exactly  */
+/* the same result as plain C kernel, because we multiply then subtract, no FMA.  */
+/* Statistics kernels work on raw samples with integer math, so they are exact.  */
+/* Long waveforms are split in pieces for a pool of workers shared by all scopes, */
+/* shorter ones are done by the caller alone.                                     */
+/*                                                                                */
+/**********************************************************************************/
+
+#ifndef	_INC_LeCroy_conv
+#define	_INC_LeCroy_conv
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/* convert pts samples from praw to pwaveform, neither has to be aligned */
+typedef void	(*LECROY_CONV_FUNC)(const void * praw, float * pwaveform, int pts, float gain, float offset);
+
+/* sums and extremes of raw samples, volts follow from gain and offset */
+typedef struct LECROY_CONV_STAT
+{
+	int	min;		/* smallest raw sample */
+	int	max;		/* biggest raw sample */
+	int	minindex;	/* first point of min, LeCroy_Conv_Stat fills it */
+	int	maxindex;	/* first point of max, LeCroy_Conv_Stat fills it */
+	double	sum;		/* of raw samples */
+	double	sumsq;		/* of their squares */
+}	LECROY_CONV_STAT;
+
+/* fill *pstat but indices for 1~LECROY_CONV_BLOCK samples from praw, not aligned */
+#define	LECROY_CONV_BLOCK	4096
+typedef void	(*LECROY_STAT_FUNC)(const void * praw, int pts, LECROY_CONV_STAT * pstat);
+
+/* kernels picked for this CPU, NULL until LeCroy_Conv_Init */
+extern LECROY_CONV_FUNC	LeCroy_Conv_Byte;
+extern LECROY_CONV_FUNC	LeCroy_Conv_Word;
+extern LECROY_STAT_FUNC	LeCroy_Stat_Byte;
+extern LECROY_STAT_FUNC	LeCroy_Stat_Word;
+
+/* LeCroy_Conv_Stat gives each worker one piece of at least LECROY_CONV_PIECE */
+/* samples, so waveforms shorter than two pieces stay in the caller thread.   */
+/* Workers are one less than cores, at most LECROY_CONV_WORKERS               */
+#define	LECROY_CONV_PIECE	262144
+#define	LECROY_CONV_WORKERS	7
+#define	LECROY_CONV_QUEUE	64	/* pieces waiting for a worker, from all scopes */
+
+/* convert like LeCroy_Conv_Byte or LeCroy_Conv_Word for samplesize 1 or 2, */
+/* and fill *pstat in the same pass over praw, block by block while it is   */
+/* still in cache. pwaveform can be NULL for statistics only, pstat for     */
+/* conversion only, pts > 0. Returns when all pieces are done               */
+void	LeCroy_Conv_Stat(const void * praw, int samplesize, float * pwaveform, int pts, float gain, float offset, LECROY_CONV_STAT * pstat);
+
+/* pick kernels, only first call does something, any thread can call it */
+void	LeCroy_Conv_Init(void);
+
+/* how many workers help with long waveforms, 0 if caller does them alone */
+int	LeCroy_Conv_Workers(void);
+
+/* cores of this host, 1 if we can't tell */
+int	LeCroy_Conv_CPUs(void);
+
+/* name of kernels we picked, like "avx2" */
+const char *	LeCroy_Conv_Name(void);
+
+/* time every kernel this CPU can run, 0 for default pts and loops */
+void	LeCroy_Conv_Bench(int pts, int loops);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif
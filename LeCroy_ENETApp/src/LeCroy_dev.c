@@ -37,6 +37,7 @@
 #include    <stdio.h>
 #include    <stdlib.h>
 #include    <string.h>
+#include    <math.h>
 #include    <alarm.h>
 #include    <dbDefs.h>
 #include    <dbAccess.h>
@@ -53,8 +54,11 @@
 #include    <aoRecord.h>
 #include    <aiRecord.h>
 #include    <stringinRecord.h>
+#include    <longoutRecord.h>
 #include    <iocsh.h>
 #include    <epicsVersion.h>
+#include    <epicsStdio.h>
+#include    <osiSock.h>
 
 #if     (EPICS_VERSION>=3 && EPICS_REVISION>=14) || EPICS_VERSION >=7
 #include    <epicsExport.h>
@@ -68,12 +72,21 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(bor->out.value.vmeio.card);\
        if (strstr(bor->out.value.vmeio.parm,"reset"))\
           data->deviceId = LT_BO_RESET;\
        else if (strstr(bor->out.value.vmeio.parm,"enbl"))\
           data->deviceId = LT_BO_ENBLCH;\
        else if (strstr(bor->out.value.vmeio.parm,"autocalS"))\
           data->deviceId = LT_BO_AUTOCAL;\
+       else if (strstr(bor->out.value.vmeio.parm,"acquire"))\
+          data->deviceId = LT_BO_ACQUIRE;\
+       else if (strstr(bor->out.value.vmeio.parm,"wfcheckS"))\
+          data->deviceId = LT_BO_WFCHECK;\
+       else if (strstr(bor->out.value.vmeio.parm,"srqS"))\
+          data->deviceId = LT_BO_SRQ;\
+       else if (strstr(bor->out.value.vmeio.parm,"roiunitS"))\
+          data->deviceId = LT_BO_ROIUNIT;\
        else\
           data->deviceId = LT_BO_RECOVER;\
        bor->dpvt=(void*)data;\
@@ -86,6 +99,7 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(bir->inp.value.vmeio.card);\
        if (strstr(bir->inp.value.vmeio.parm, "statusch"))\
          data->deviceId = LT_BI_CHSTAT;\
        else if (strstr(bir->inp.value.vmeio.parm, "autocalM"))\
@@ -99,6 +113,7 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(mbbir->inp.value.vmeio.card);\
        if (!strcmp(mbbir->inp.value.vmeio.parm, "memsizeM"))\
           data->deviceId = LT_MBBI_MEMSZ;\
        else if (!strcmp(mbbir->inp.value.vmeio.parm, "trgmodeM"))\
@@ -116,6 +131,7 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(mbbor->out.value.vmeio.card);\
        if (!strcmp(mbbor->out.value.vmeio.parm, "memsizeS"))\
           data->deviceId = LT_MBBO_MEMSZ;\
        else if (!strcmp(mbbor->out.value.vmeio.parm, "trgmodeS"))\
@@ -126,6 +142,8 @@
           data->deviceId = LT_MBBO_LDPNLSTP;\
        else if (!strcmp(mbbor->out.value.vmeio.parm, "svpnlstp"))\
           data->deviceId = LT_MBBO_SVPNLSTP;\
+       else if (!strcmp(mbbor->out.value.vmeio.parm, "formatS"))\
+          data->deviceId = LT_MBBO_FORMAT;\
        mbbor->dpvt=(void*)data;\
        paramOK=1;\
  }
@@ -135,11 +153,47 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(air->inp.value.vmeio.card);\
        if (!strcmp(air->inp.value.vmeio.parm, "timedivM"))\
           data->deviceId = LT_AI_TIMEDIV;\
        else if (strstr(air->inp.value.vmeio.parm, "voltdiv"))\
           data->deviceId = LT_AI_VOLTDIV;\
+       else if (strstr(air->inp.value.vmeio.parm, "gain"))\
+          data->deviceId = LT_AI_GAIN;\
+       else if (strstr(air->inp.value.vmeio.parm, "offset"))\
+          data->deviceId = LT_AI_OFFSET;\
+       else if (!strcmp(air->inp.value.vmeio.parm, "wfreadM"))\
+          data->deviceId = LT_AI_WFREAD;\
+       else if (!strcmp(air->inp.value.vmeio.parm, "wfskipM"))\
+          data->deviceId = LT_AI_WFSKIP;\
+       else if (!strcmp(air->inp.value.vmeio.parm, "wfskipratioM"))\
+          data->deviceId = LT_AI_WFSKIPRATIO;\
+       else if (strstr(air->inp.value.vmeio.parm, "roibase"))\
+          data->deviceId = LT_AI_ROIBASE;\
+       else if (strstr(air->inp.value.vmeio.parm, "roi"))\
+          data->deviceId = LT_AI_ROI;\
+       else if (strstr(air->inp.value.vmeio.parm, "minch"))\
+          data->deviceId = LT_AI_MIN;\
+       else if (strstr(air->inp.value.vmeio.parm, "maxch"))\
+          data->deviceId = LT_AI_MAX;\
+       else if (strstr(air->inp.value.vmeio.parm, "meanch"))\
+          data->deviceId = LT_AI_MEAN;\
+       else if (strstr(air->inp.value.vmeio.parm, "rmsch"))\
+          data->deviceId = LT_AI_RMS;\
+       else if (strstr(air->inp.value.vmeio.parm, "areach"))\
+          data->deviceId = LT_AI_AREA;\
+       else if (strstr(air->inp.value.vmeio.parm, "peakch"))\
+          data->deviceId = LT_AI_PEAK;\
+       else if (strstr(air->inp.value.vmeio.parm, "t0"))\
+          data->deviceId = LT_AI_T0;\
+       else if (strstr(air->inp.value.vmeio.parm, "dt"))\
+          data->deviceId = LT_AI_DT;\
+       data->index = roiIndex(air->inp.value.vmeio.parm);\
        air->dpvt=(void*) data;\
+       if (WFSTAT_AI(data->deviceId))\
+          statUser(air);\
+       if (ROI_AI(data->deviceId))\
+          roiUser(air);\
        return (0);\
  }
 
@@ -148,19 +202,48 @@
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(aor->out.value.vmeio.card);\
        if (!strcmp(aor->out.value.vmeio.parm, "timedivS"))\
 	       data->deviceId = LT_AO_TIMEDIV;\
        else if (strstr(aor->out.value.vmeio.parm, "voltdiv"))\
 	       data->deviceId = LT_AO_VOLTDIV;\
+       else if (!strcmp(aor->out.value.vmeio.parm, "trgoffsetS"))\
+	       data->deviceId = LT_AO_TRGOFFSET;\
+       else if (strstr(aor->out.value.vmeio.parm, "basestart"))\
+	       data->deviceId = LT_AO_BASESTART;\
+       else if (strstr(aor->out.value.vmeio.parm, "basestop"))\
+	       data->deviceId = LT_AO_BASESTOP;\
+       else if (strstr(aor->out.value.vmeio.parm, "start"))\
+	       data->deviceId = LT_AO_ROISTART;\
+       else if (strstr(aor->out.value.vmeio.parm, "stop"))\
+	       data->deviceId = LT_AO_ROISTOP;\
+       data->index = roiIndex(aor->out.value.vmeio.parm);\
        aor->dpvt=(void*) data;\
        paramOK=1;\
  }
 
+#define CHECK_LOPARM(PARM)\
+ if (!strncmp(lor->out.value.vmeio.parm, (PARM), strlen(PARM))){\
+       DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
+       data->bufSize = 0;   /* not used */\
+       data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(lor->out.value.vmeio.card);\
+       if (strstr(lor->out.value.vmeio.parm, "sparsing"))\
+          data->deviceId = LT_LO_SPARSING;\
+       else if (strstr(lor->out.value.vmeio.parm, "npoints"))\
+          data->deviceId = LT_LO_NPOINTS;\
+       else if (strstr(lor->out.value.vmeio.parm, "firstpnt"))\
+          data->deviceId = LT_LO_FIRSTPNT;\
+       lor->dpvt=(void*) data;\
+       paramOK=1;\
+ }
+
 #define CHECK_STRINGIN(PARM)\
  if (!strncmp(stringinr->inp.value.vmeio.parm, (PARM), strlen(PARM))){\
        DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));\
        data->bufSize = 0;   /* not used */\
        data->buffer = NULL; /* not used */\
+       data->ps = scopeOf(stringinr->inp.value.vmeio.card);\
        if (!strcmp(stringinr->inp.value.vmeio.parm, "model"))\
           data->deviceId = LT_STRINGIN_MODEL;\
        else if (!strcmp(stringinr->inp.value.vmeio.parm, "serial"))\
@@ -175,144 +258,1189 @@
        return (0);\
  }
 
+/***************************************************************************************/
+/***********************************  STATUS POLL **************************************/
+/***************************************************************************************/
+/* read whole status with one query, then process all I/O Intr records of this scope */
+static void pollStatus(SCOPE* ps)
+{
+  int status;
+  LECROY_STATUS scopestat;
+  LECROY_STATS stats;
+
+  /* counters cost nothing on the link, keep them for passive records too */
+  if (LeCroy_Get_Stats(ps->scopeID, &stats) == OK){
+    epicsMutexLock(ps->statusLock);
+    ps->scopeStats = stats;
+    epicsMutexUnlock(ps->statusLock);
+  }
+
+  if (ps->statusUsers == 0)
+    return; /* nobody listens, don't load the link */
+
+  status = LeCroy_Get_Status(ps->scopeID, &scopestat);
+
+  epicsMutexLock(ps->statusLock);
+  if (status == OK)
+    ps->scopeStatus = scopestat;
+  ps->statusValid = (status == OK);
+  epicsMutexUnlock(ps->statusLock);
+
+  /* even on failure, so records go to alarm */
+  scanIoRequest(ps->statusScan);
+}
+
+/* I/O Intr records take last poll, return ERROR if it failed */
+static int getStatus(SCOPE* ps, LECROY_STATUS* pstatus)
+{
+  int valid;
+
+  epicsMutexLock(ps->statusLock);
+  *pstatus = ps->scopeStatus;
+  valid = ps->statusValid;
+  epicsMutexUnlock(ps->statusLock);
+
+  return valid ? OK : ERROR;
+}
+
+/* shared by bi, mbbi and ai, every scope has one I/O Intr list for status */
+static long statusIoinitInfo(int cmd, struct dbCommon* prec, struct link* plink, IOSCANPVT* iopvt)
+{
+  DPVT_DATA* dpvt = (DPVT_DATA*) prec->dpvt;
+  SCOPE* ps;
+
+  if (plink->type != VME_IO || dpvt == NULL)
+    return (S_db_badField);
+  ps = dpvt->ps;
+  if (ps == NULL || ps->statusLock == NULL){
+    recGblRecordError(S_db_badField, (void*)prec,
+		      "devLT364 (IoinitInfo) Scope not initialized");
+    return (S_db_badField);
+  }
+
+  /* cmd 0 means record joins I/O Intr list, 1 means it leaves */
+  epicsMutexLock(ps->statusLock);
+  ps->statusUsers += (cmd == 0) ? 1 : -1;
+  epicsMutexUnlock(ps->statusLock);
+
+  *iopvt = ps->statusScan;
+  return 0;
+}
+
+/* tScopePool, runs strands that have messages, a few messages each */
 static void
-readLTHelper( void *parm)
+poolLTHelper( void *parm)
 {
-  epicsMessageQueueId qID = (epicsMessageQueueId)parm;
+  STRAND* pstrand;
   TASK_DATA message;
+  int n;
 
   for( ;;) {
-    message.pRecord = NULL;
-    if ( epicsMessageQueueReceive( qID, (void *)&message, MAX_MSG_LENGTH) == ERROR || message.pRecord == NULL) { 
-      /* give up CPU for a bit */ 
-      epicsThreadSleep( epicsThreadSleepQuantum());
+    epicsMutexLock(strandLock);
+    pstrand = (STRAND*) ellGet(&poolList);
+    if (pstrand != NULL && ellCount(&poolList) > 0)
+      epicsEventSignal(poolEvent); /* more for other workers */
+    epicsMutexUnlock(strandLock);
+    if (pstrand == NULL){
+      epicsEventWait(poolEvent);
       continue;
     }
 
-    switch (message.cmd){
-    case GETWF:
-      handleWf(&message);
-      break;
-    case LT_STRINGIN_TRGTIME:
-      handleStringIn(&message);
-      break;
-    case ENABLECHAN:
-    case DISABLECHAN:
-      handleEnableDisable(&message);
-      break;
-    case LT_BO_RECOVER:
-    case ENABLEACAL:
-    case DISABLEACAL:
-    case RESET:
-      handleBo(&message);
-      break;
-    case GETCHANSTAT:
-    case GETACALSTAT:
-      handleBi(&message);
-      break;
-    case GETMEMSIZE:
-    case GETTRGMODE:
-    case GETTRGSRC:
-    case LT_MBBI_LINKSTATUS:
-      handleMbbi(&message);
-      break;
-    case SETMEMSIZE:
-    case SETTRGMODE:
-    case SETTRGSRC:
-    case LDPNLSTP:
-    case SVPNLSTP:
-      handleMbbo(&message);
-      break;
-    case SETTIMEDIV:
-    case SETVOLTDIV:
-      handleAo(&message);
+    /* control lane first, bulk only when it is empty */
+    for (n = 0; n < STRAND_BATCH; n++){
+      if (epicsMessageQueueTryReceive(pstrand->qid, (void *)&message, MAX_MSG_LENGTH) == ERROR &&
+	  (pstrand->bulk == NULL ||
+	   epicsMessageQueueTryReceive(pstrand->bulk, (void *)&message, MAX_MSG_LENGTH) == ERROR))
+	break;
+      (*pstrand->run)(pstrand->ps, &message);
+    }
+
+    /* back in line if more came, strandPost checks under same lock */
+    epicsMutexLock(strandLock);
+    if (epicsMessageQueuePending(pstrand->qid) > 0 ||
+	(pstrand->bulk != NULL && epicsMessageQueuePending(pstrand->bulk) > 0)){
+      ellAdd(&poolList, &pstrand->node);
+      epicsEventSignal(poolEvent);
+    }
+    else
+      pstrand->scheduled = 0;
+    epicsMutexUnlock(strandLock);
+  }
+}
+
+/* queue message in its lane of strand and give strand to a worker if */
+/* none has it, return ERROR if lane is full                           */
+static int strandPost(STRAND* pstrand, TASK_DATA* message)
+{
+  epicsMessageQueueId qid = pstrand->qid;
+
+  if (pstrand->bulk != NULL && bulkMsg(message->cmd))
+    qid = pstrand->bulk;
+  if (qid == NULL ||
+      epicsMessageQueueTrySend(qid, (void *)message, sizeof(TASK_DATA)) == ERROR)
+    return ERROR;
+
+  epicsMutexLock(strandLock);
+  if (!pstrand->scheduled){
+    pstrand->scheduled = 1;
+    ellAdd(&poolList, &pstrand->node);
+    epicsEventSignal(poolEvent);
+  }
+  epicsMutexUnlock(strandLock);
+  return OK;
+}
+
+/* waveform reads, everything else is short and goes first */
+static int bulkMsg(int cmd)
+{
+  return (cmd == GETWF || cmd == LT_WF_SEQ || cmd == LT_BO_ACQUIRE);
+}
+
+/* run what is in control lane of scope strand now, from a long message */
+/* of the same strand between its transfers, so the link is still ours. */
+/* LT_SRQ waits until that message is done, acquire record is busy with */
+/* it and would miss scanIoRequest                                      */
+static void strandYield(SCOPE* ps)
+{
+  TASK_DATA message;
+  int gotSrq = 0;
+
+  while (epicsMessageQueueTryReceive(ps->strand.qid, (void *)&message, MAX_MSG_LENGTH) != ERROR){
+    if (message.cmd == LT_SRQ){
+      gotSrq = 1;
+      continue;
+    }
+    handleMsg(ps, &message);
+  }
+
+  if (gotSrq){
+    epicsMutexLock(strandLock);
+    srqPost(ps);
+    epicsMutexUnlock(strandLock);
+  }
+}
+
+/* on timerQueue thread, nothing here may wait for the link */
+static void scopeTimerExpire(void *parm)
+{
+  SCOPE_TIMER* ptimer = (SCOPE_TIMER*) parm;
+  SCOPE* ps = ptimer->ps;
+  TASK_DATA message;
+
+  /* before posting, so handleTimer may start it sooner */
+  epicsTimerStartDelay(ptimer->timer, ptimer->period);
+
+  epicsMutexLock(strandLock);
+  if (!ptimer->pending){
+    message.scopeID = ps->scopeID;
+    message.channel = 0;
+    message.cmd = ptimer->cmd;
+    message.pRecord = NULL;
+    ptimer->pending = (strandPost(&ps->strand, &message) == OK);
+  }
+  epicsMutexUnlock(strandLock);
+}
+
+/* periodic work of scope, in its strand */
+static void handleTimer(SCOPE* ps, TASK_DATA* message)
+{
+  int linkstat, busy;
+
+  epicsMutexLock(strandLock);
+  ps->timer[message->cmd - LT_TIMER_STATUS].pending = 0; /* next tick may post again */
+  epicsMutexUnlock(strandLock);
+
+  switch (message->cmd){
+  case LT_TIMER_STATUS:
+    pollStatus(ps);
+    break;
+  case LT_TIMER_LINK:
+    if (LeCroy_Get_LinkStat(ps->scopeID, &linkstat) == ERROR || linkstat == LINK_OK)
       break;
-    case GETTIMEDIV:
-    case GETVOLTDIV:
-      handleAi(&message);
+    epicsMutexLock(strandLock);
+    busy = (linkRecovers >= linkRecoverMax);
+    if (!busy)
+      linkRecovers++;
+    epicsMutexUnlock(strandLock);
+    if (busy){
+      /* workers are for scopes that are there, ask again soon */
+      epicsTimerStartDelay(ps->timer[message->cmd - LT_TIMER_STATUS].timer, LINK_CHECK_TIMEOUT);
       break;
-    default:
-      printf("Unknown record type\n");
     }
+    LeCroy_Recover_Link(ps->scopeID, -1, LINK_CHECK_TIMEOUT);
+    epicsMutexLock(strandLock);
+    linkRecovers--;
+    epicsMutexUnlock(strandLock);
+    srqWake(); /* socket may be a new one */
+    break;
+  }
+}
+
+/* datagram to ourselves, wakes tScopeSrq out of select */
+static SOCKET srqWakeSock = INVALID_SOCKET;
+
+/* tScopeSrq, one for all scopes, nothing here may wait for the link */
+static void srqWatch(void *parm)
+{
+  struct sockaddr_in addr;
+  osiSocklen_t len = sizeof(addr);
+  fd_set readFds;
+  struct timeval tv;
+  SCOPE* ps;
+  int num, fd, maxfd;
+  BOOL taken;
+  char c;
+
+  srqWakeSock = epicsSocketCreate(AF_INET, SOCK_DGRAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (srqWakeSock != INVALID_SOCKET &&
+      (bind(srqWakeSock, (struct sockaddr*) &addr, sizeof(addr)) < 0 ||
+       getsockname(srqWakeSock, (struct sockaddr*) &addr, &len) < 0 ||
+       connect(srqWakeSock, (struct sockaddr*) &addr, sizeof(addr)) < 0)){
+    epicsSocketDestroy(srqWakeSock);
+    srqWakeSock = INVALID_SOCKET;
+  }
+  if (srqWakeSock == INVALID_SOCKET)
+    printf("Error creating wakeup socket for SRQ, acquire may lag %g seconds\n", SRQ_WATCH_PERIOD);
+
+  for( ;;) {
+    FD_ZERO(&readFds);
+    maxfd = -1;
+    if (srqWakeSock != INVALID_SOCKET){
+      FD_SET(srqWakeSock, &readFds);
+      maxfd = (int) srqWakeSock;
+    }
+    epicsMutexLock(strandLock);
+    for (num = 0; num < scopeSlots; num++){
+      ps = scopeList[num];
+      if (ps == NULL || ps->status != OK || ps->srqUsers <= 0 || ps->srqPending ||
+	  LeCroy_Get_SrqFd(ps->scopeID, &fd, &taken) == ERROR)
+	continue;
+      if (taken)
+	srqPost(ps); /* came during a transaction, socket stays quiet */
+      else if (fd != ERROR && fd < FD_SETSIZE){
+	FD_SET(fd, &readFds);
+	if (fd > maxfd)
+	  maxfd = fd;
+      }
+    }
+    epicsMutexUnlock(strandLock);
+
+    tv.tv_sec = (long) SRQ_WATCH_PERIOD;
+    tv.tv_usec = (long) ((SRQ_WATCH_PERIOD - tv.tv_sec) * 1e6);
+    if (select(maxfd + 1, &readFds, NULL, NULL, &tv) <= 0)
+      continue; /* timeout, or a socket closed by link down */
+
+    if (srqWakeSock != INVALID_SOCKET && FD_ISSET(srqWakeSock, &readFds))
+      recv(srqWakeSock, &c, 1, 0);
+    epicsMutexLock(strandLock);
+    for (num = 0; num < scopeSlots; num++){
+      ps = scopeList[num];
+      if (ps == NULL || ps->status != OK || ps->srqUsers <= 0 || ps->srqPending ||
+	  LeCroy_Get_SrqFd(ps->scopeID, &fd, &taken) == ERROR)
+	continue;
+      if (fd != ERROR && fd < FD_SETSIZE && FD_ISSET(fd, &readFds))
+	srqPost(ps);
+    }
+    epicsMutexUnlock(strandLock);
+  }
+}
+
+/* under strandLock, LT_SRQ goes to scope strand once until handleSrq. */
+/* If control lane is full, socket stays out of select meanwhile, else  */
+/* tScopeSrq would find it readable and try again without end           */
+static void srqPost(SCOPE* ps)
+{
+  TASK_DATA message;
+
+  message.scopeID = ps->scopeID;
+  message.channel = 0;
+  message.cmd = LT_SRQ;
+  message.pRecord = NULL;
+  ps->srqPending = 1;
+  ps->srqLost = (strandPost(&ps->strand, &message) == ERROR);
+}
+
+/* tScopeSrq selects on sockets again, right away */
+static void srqWake(void)
+{
+  char c = 0;
+
+  if (srqWakeSock != INVALID_SOCKET)
+    send(srqWakeSock, &c, 1, 0);
+}
+
+/* in scope strand, takes what made socket readable, SRQ or a stale block */
+static void handleSrq(SCOPE* ps)
+{
+  if (LeCroy_Wait_Srq(ps->scopeID, 0) == OK)
+    scanIoRequest(ps->srqScan);
+
+  epicsMutexLock(strandLock);
+  ps->srqPending = 0;
+  epicsMutexUnlock(strandLock);
+  srqWake();
+}
+
+/* decode strand, second stage of waveform records */
+static void decodeMsg(SCOPE* ps, TASK_DATA* message)
+{
+  if (message->pRecord != NULL)
+    decodeWf(message);
+}
+
+/* scope strand, everything that uses the link */
+static void handleMsg(SCOPE* ps, TASK_DATA* message)
+{
+  int fd;
+  BOOL taken;
+
+  if (message->cmd == LT_SRQ){
+    handleSrq(ps);
+    return;
+  }
+  if (message->cmd >= LT_TIMER_STATUS && message->cmd <= LT_TIMER_LINK)
+    handleTimer(ps, message);
+  else if (message->pRecord != NULL)
+    handleRecord(message);
+
+  /* SRQ that came during our transactions, tScopeSrq doesn't see it, */
+  /* or one that didn't fit in control lane, there is room now         */
+  if (ps->srqLost ||
+      (ps->srqUsers > 0 && LeCroy_Get_SrqFd(ps->scopeID, &fd, &taken) == OK && taken)){
+    epicsMutexLock(strandLock);
+    if (ps->srqLost || !ps->srqPending)
+      srqPost(ps);
+    epicsMutexUnlock(strandLock);
   }
 }
 
-/* initializiation routine */
-void init_LT364(int num, char* ipaddr)
+/* record messages of scope strand */
+static void handleRecord(TASK_DATA* message)
 {
-  epicsThreadId taskId;
-  /* int	dummy,ch,status; */
+  switch (message->cmd){
+  case GETWF:
+    handleWf(message);
+    break;
+  case LT_WF_SEQ:
+    handleSeq(message);
+    break;
+  case LT_BO_ACQUIRE:
+    handleAcquire(message);
+    break;
+  case LT_LO_SPARSING:
+  case LT_LO_NPOINTS:
+  case LT_LO_FIRSTPNT:
+    handleLo(message);
+    break;
+  case LT_STRINGIN_TRGTIME:
+    handleStringIn(message);
+    break;
+  case ENABLECHAN:
+  case DISABLECHAN:
+    handleEnableDisable(message);
+    break;
+  case LT_BO_RECOVER:
+  case ENABLEACAL:
+  case DISABLEACAL:
+  case ENABLESRQ:
+  case DISABLESRQ:
+  case RESET:
+    handleBo(message);
+    break;
+  case GETCHANSTAT:
+  case GETACALSTAT:
+    handleBi(message);
+    break;
+  case GETMEMSIZE:
+  case GETTRGMODE:
+  case GETTRGSRC:
+  case LT_MBBI_LINKSTATUS:
+    handleMbbi(message);
+    break;
+  case SETMEMSIZE:
+  case SETTRGMODE:
+  case SETTRGSRC:
+  case LDPNLSTP:
+  case SVPNLSTP:
+  case SETFORMAT:
+    handleMbbo(message);
+    break;
+  case SETTIMEDIV:
+  case SETVOLTDIV:
+    handleAo(message);
+    break;
+  case GETTIMEDIV:
+  case GETVOLTDIV:
+    handleAi(message);
+    break;
+  default:
+    printf("Unknown record type\n");
+  }
+}
+
+/* scope of a card, NULL if init_LT364 didn't make it */
+static SCOPE* scopeOf(int num)
+{
+  return (num >= 0 && num < scopeSlots) ? scopeList[num] : NULL;
+}
+
+/* lecroyPoolThreads workers for all scopes, 0 picks POOL_THREADS_PER_CPU */
+/* per core. Set it before first init_LT364                                 */
+int lecroyPoolThreads = 0;
+static int poolThreads;
+static epicsThreadOnceId poolOnce = EPICS_THREAD_ONCE_INIT;
+
+static void startPool(void *parm)
+{
+  char name[24];
+  int i;
+
+  poolThreads = lecroyPoolThreads;
+  if (poolThreads <= 0){
+    poolThreads = POOL_THREADS_PER_CPU * LeCroy_Conv_CPUs();
+    if (poolThreads < POOL_MIN_THREADS)
+      poolThreads = POOL_MIN_THREADS;
+  }
+
+  strandLock = epicsMutexCreate();
+  poolEvent = epicsEventCreate(epicsEventEmpty);
+  ellInit(&poolList);
+  timerQueue = epicsTimerQueueAllocate(1, eventTaskPriority);
+  if (strandLock == NULL || poolEvent == NULL || timerQueue == NULL)
+    return;
 
-  scopeID[num] = LeCroy_Open(ipaddr,FOUR_CHANNEL_SCOPE,1);
+  for (i = 0; i < poolThreads; i++){
+    epicsSnprintf(name, sizeof(name), "tScopePool%d", i);
+    if (epicsThreadCreate(name, eventTaskPriority, 20 * 1024, poolLTHelper, NULL) == NULL)
+      break;
+  }
+  poolThreads = i;
+  linkRecoverMax = poolThreads / LINK_RECOVER_SHARE;
+  if (linkRecoverMax < 1)
+    linkRecoverMax = 1;
+
+  if (epicsThreadCreate("tScopeSrq", eventTaskPriority, 20 * 1024, srqWatch, NULL) == NULL)
+    printf("Error creating SRQ thread for scopes\n");
+}
+
+/* initializiation routine, format is LECROY_FMT_BYTE(1) or LECROY_FMT_WORD(2),
+   0 means BYTE, formatS record can change it later */
+void init_LT364(int num, char* ipaddr, int format)
+{
+  SCOPE* ps;
+  int ch, i;
+  /* int	dummy,status; */
+
+  if (num < 0 || scopeOf(num) != NULL){
+    printf("Scope %d is not a free card number\n", num);
+    return;
+  }
+  epicsThreadOnce(&poolOnce, startPool, NULL);
+  if (poolEvent == NULL || strandLock == NULL || timerQueue == NULL){
+    printf("Error creating worker pool for scopes\n");
+    return;
+  }
+
+  ps = (SCOPE*) calloc(1, sizeof(SCOPE));
+  if (ps == NULL){
+    printf("Error allocating scope\n");
+    return;
+  }
+  ps->num = num;
+  ps->status = ERROR; /* tScopeSrq looks at it from now on */
+
+  /* registry grows to biggest card, records look it up in init_record */
+  epicsMutexLock(strandLock);
+  if (num >= scopeSlots){
+    SCOPE** plist = (SCOPE**) realloc(scopeList, (num + 1) * sizeof(SCOPE*));
+
+    if (plist == NULL){
+      epicsMutexUnlock(strandLock);
+      free(ps);
+      printf("Error allocating scope list\n");
+      return;
+    }
+    memset(plist + scopeSlots, 0, (num + 1 - scopeSlots) * sizeof(SCOPE*));
+    scopeList = plist;
+    scopeSlots = num + 1;
+  }
+  scopeList[num] = ps;
+  epicsMutexUnlock(strandLock);
+
+  /* link check is one of our timers, not a thread of driver */
+  ps->scopeID = LeCroy_Open(ipaddr,FOUR_CHANNEL_SCOPE,0);
+  if (ps->scopeID && format != 0 && format != LECROY_FMT_BYTE){
+    /* kept even if scope is not there yet, it goes out when link comes up */
+    if (LeCroy_Set_Format(ps->scopeID, format) == ERROR)
+      LeCroy_Print_Lasterr(ps->scopeID);
+  }
   
-  /* create message queue - one per scope */
-  msgQID[num] = epicsMessageQueueCreate( MAX_MSGS, MAX_MSG_LENGTH);
-  if (msgQID[num] == NULL){
+  /* create message queues - control and bulk lane per scope */
+  ps->strand.ps = ps;
+  ps->strand.run = handleMsg;
+  ps->strand.qid = epicsMessageQueueCreate( MAX_MSGS, MAX_MSG_LENGTH);
+  ps->strand.bulk = epicsMessageQueueCreate( MAX_MSGS, MAX_MSG_LENGTH);
+  if (ps->strand.qid == NULL || ps->strand.bulk == NULL){
     /* problem creating task */
     printf("Error creating message queue for scope\n");
-    SCOPE_STATUS[num] = ERROR;
+    ps->status = ERROR;
+    return;
+  }
+  /* second stage of waveform records, they go inline without it */
+  ps->decode.ps = ps;
+  ps->decode.run = decodeMsg;
+  ps->decode.qid = epicsMessageQueueCreate( MAX_MSGS, MAX_MSG_LENGTH);
+  if (ps->decode.qid == NULL)
+    printf("Error creating decode queue for scope, decoding inline\n");
+  /* I/O Intr list for status records, must be there before iocInit */
+  scanIoInit(&ps->statusScan);
+  ps->statusLock = epicsMutexCreate();
+  if (ps->statusLock == NULL){
+    printf("Error creating status lock for scope\n");
+    ps->status = ERROR;
     return;
   }
-  taskId = epicsThreadCreate( "tScopeHandle", eventTaskPriority, 20 * 1024, readLTHelper, (void *)msgQID[num]);
+  /* I/O Intr lists for waveform records of one acquisition */
+  for (ch = 0; ch < MAX_CHANNELS; ch++){
+    scanIoInit(&ps->acqChannel[ch].scan);
+    scanIoInit(&ps->acqChannel[ch].statScan);
+    ps->acqChannel[ch].statStatus = ERROR;
+    scanIoInit(&ps->roiChannel[ch].scan);
+    ps->acqChannel[ch].status = ERROR;     /* nothing read yet */
+    ps->acqChannel[ch].lastStatus = ERROR;
+    scanIoInit(&ps->seqChannel[ch].scan);
+    ps->seqChannel[ch].status = ERROR;
+  }
+  for (ch = 0; ch < TOTALCHNLS; ch++){
+    scanIoInit(&ps->arr2Channel[ch].scan);
+    ps->arr2Channel[ch].status = ERROR;
+  }
+  ps->acqLock = epicsMutexCreate();
+  ps->backLock = epicsMutexCreate();
+  if (ps->acqLock == NULL || ps->backLock == NULL){
+    printf("Error creating acquisition lock for scope\n");
+    ps->status = ERROR;
+    return;
+  }
+  /* I/O Intr list for acquire record, processed on service request */
+  scanIoInit(&ps->srqScan);
+
+  /* status poll right away like before, link check after one period */
+  for (i = 0; i < SCOPE_TIMERS; i++){
+    SCOPE_TIMER* ptimer = &ps->timer[i];
+
+    ptimer->ps = ps;
+    ptimer->cmd = LT_TIMER_STATUS + i;
+    ptimer->period = (ptimer->cmd == LT_TIMER_STATUS) ? STATUS_POLL_PERIOD : LINK_CHECK_PERIOD;
+    if (ptimer->cmd != LT_TIMER_STATUS && !ps->scopeID)
+      continue; /* nothing to recover */
+    ptimer->timer = epicsTimerQueueCreateTimer(timerQueue, scopeTimerExpire, ptimer);
+    if (ptimer->timer == NULL){
+      printf("Error creating timer for scope\n");
+      ps->status = ERROR;
+      return;
+    }
+    epicsTimerStartDelay(ptimer->timer, (ptimer->cmd == LT_TIMER_STATUS) ? 0.0 : ptimer->period);
+  }
   
-  SCOPE_STATUS[num] = OK;
+  ps->status = OK;
   /*for (ch = 1; ch <= MAX_CHANNELS; ch++){
-    status = LeCroy_Ioctl(scopeID[num], ch, ENABLECHAN, &dummy);
+    status = LeCroy_Ioctl(ps->scopeID, ch, ENABLECHAN, &dummy);
     if (status == ERROR) {
       printf("devWfLT364 (init_LT364) channel enabling failed\n");
-      SCOPE_STATUS[num] = ERROR;
+      ps->status = ERROR;
     }
   }*/
-  if (SCOPE_STATUS[num] == OK)
+  if (ps->status == OK)
     printf("Scope %d with IP-addr (%s) initialized.\n", num, ipaddr);
 }
 
+/* dbior report, one line per scope, traffic counters with level > 0 */
+static long reportLT364(int level)
+{
+  int num, linkstat, format;
+  char ipaddr[40]; /* see LeCroy_Get_IPAddr */
+  LECROY_STATS stats;
+  SCOPE* ps;
+
+  printf("  LeCroy conversion kernel: %s, %d workers for long waveforms\n", LeCroy_Conv_Name(), LeCroy_Conv_Workers());
+  printf("  LeCroy pool: %d workers for all scopes\n", poolThreads);
+  for (num = 0; num < scopeSlots; num++){
+    ps = scopeList[num];
+    if (ps == NULL || ps->scopeID == 0)
+      continue;
+    LeCroy_Get_IPAddr(ps->scopeID, ipaddr);
+    LeCroy_Get_LinkStat(ps->scopeID, &linkstat);
+    LeCroy_Ioctl(ps->scopeID, 0, GETFORMAT, &format);
+    printf("  Scope %d (%s): link %s, format %s\n", num, ipaddr,
+	   (linkstat == LINK_OK) ? "OK" : "DOWN",
+	   (format == LECROY_FMT_WORD) ? "WORD" : "BYTE");
+    if (level > 0 && LeCroy_Get_Stats(ps->scopeID, &stats) == OK){
+      printf("    %u waveforms, %.0f waveform bytes, %.0f bytes received\n",
+	     stats.waveforms, stats.wfbytes, stats.rxbytes);
+      printf("    wfcheck %s, %u checked, %u not transferred, %u service requests\n",
+	     ps->wfCheck ? "ON" : "OFF", stats.checks, stats.skipped, stats.srqs);
+    }
+  }
+  return 0;
+}
+
 /***************************************************************************************/
 /***********************************  WAVEFORM RECORD **********************************/
 /***************************************************************************************/
 static long initRecord(struct waveformRecord* pwf)
 {
+  DPVT_DATA* data;
+  int deviceId = GETWF;
+  char* parm = pwf->inp.value.vmeio.parm;
+  SCOPE* ps = (pwf->inp.type == VME_IO) ? scopeOf(pwf->inp.value.vmeio.card) : NULL;
+
+  if (pwf->inp.type == VME_IO && parm != NULL){
+    if (!strcmp(parm, "seqtime"))
+      deviceId = LT_WF_SEQTIME;
+    else if (!strcmp(parm, "seqoffset"))
+      deviceId = LT_WF_SEQOFFSET;
+    else if (!strcmp(parm, "seq"))
+      deviceId = LT_WF_SEQ;
+    else if (!strcmp(parm, "array2"))
+      deviceId = LT_WF_ARRAY2;
+    else if (!strcmp(parm, "time"))
+      deviceId = LT_WF_TIME;
+  }
+
+  if (deviceId == LT_WF_TIME){
+    /* seconds from trigger of each point, from WAVEDESC of channel */
+    int ch = pwf->inp.value.vmeio.signal;
+
+    if (pwf->ftvl != DBF_DOUBLE){
+      recGblRecordError(S_db_badField, (void*)pwf,
+			"devWfLT364 (initRecord) FTVL must be DOUBLE for time");
+      pwf->pact=TRUE;
+      return (S_db_badField);
+    }
+    if (ch < 1 || ch > MAX_CHANNELS){
+      recGblRecordError(S_db_badField, (void*)pwf,
+			"devWfLT364 (initRecord) bad channel for time");
+      pwf->pact=TRUE;
+      return (S_db_badField);
+    }
+    data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));
+    memset(data, 0, sizeof(DPVT_DATA)); /* no axis in record yet */
+    data->deviceId = deviceId;
+    data->ps = ps;
+    pwf->dpvt=(void*)data;
+    return(0);
+  }
+
+  if (deviceId == LT_WF_SEQTIME || deviceId == LT_WF_SEQOFFSET){
+    /* seconds of each segment, from TRIGTIME_ARRAY */
+    int ch = pwf->inp.value.vmeio.signal;
+    SEQ_CHANNEL* pseq;
+
+    if (pwf->ftvl != DBF_DOUBLE){
+      recGblRecordError(S_db_badField, (void*)pwf,
+			"devWfLT364 (initRecord) FTVL must be DOUBLE for seqtime and seqoffset");
+      pwf->pact=TRUE;
+      return (S_db_badField);
+    }
+    if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > MAX_CHANNELS){
+      recGblRecordError(S_db_badField, (void*)pwf,
+			"devWfLT364 (initRecord) Scope not initialized or bad channel");
+      pwf->pact=TRUE;
+      return (S_db_badField);
+    }
+    /* both buffers have to hold the longest of them, times and offsets share them */
+    pseq = &ps->seqChannel[ch-1];
+    epicsMutexLock(ps->backLock);
+    epicsMutexLock(ps->acqLock);
+    if (pseq->maxseg < pwf->nelm){
+      LECROY_SEGTIME* psegtime = (LECROY_SEGTIME*) calloc(pwf->nelm, sizeof(LECROY_SEGTIME));
+      LECROY_SEGTIME* pback = (LECROY_SEGTIME*) calloc(pwf->nelm, sizeof(LECROY_SEGTIME));
+      if (psegtime != NULL && pback != NULL){
+	free(pseq->segtime);
+	free(pseq->back);
+	pseq->segtime = psegtime;
+	pseq->back = pback;
+	pseq->maxseg = pwf->nelm;
+	pseq->status = ERROR; /* nothing in new buffer yet */
+      }
+      else {
+	free(psegtime);
+	free(pback);
+      }
+    }
+    epicsMutexUnlock(ps->acqLock);
+    epicsMutexUnlock(ps->backLock);
+    data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));
+    memset(data, 0, sizeof(DPVT_DATA));
+    data->deviceId = deviceId;
+    data->ps = ps;
+    pwf->dpvt=(void*)data;
+    return(0);
+  }
+
+  /* FLOAT gets volts, CHAR and SHORT get raw samples, see storeWf */
+  if (pwf->ftvl != DBF_FLOAT && pwf->ftvl != DBF_CHAR && pwf->ftvl != DBF_SHORT){
+    recGblRecordError(S_db_badField, (void*)pwf,
+		      "devWfLT364 (initRecord) FTVL must be FLOAT, CHAR or SHORT");
+    pwf->pact=TRUE;
+    return (S_db_badField);
+  }
+
+  if (deviceId == LT_WF_ARRAY2){
+    /* WAVE_ARRAY_2, read along with waveform record of channel */
+    int ch = pwf->inp.value.vmeio.signal;
+    ARR2_CHANNEL* parr2;
+
+    if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > TOTALCHNLS){
+      recGblRecordError(S_db_badField, (void*)pwf,
+			"devWfLT364 (initRecord) Scope not initialized or bad channel");
+      pwf->pact=TRUE;
+      return (S_db_badField);
+    }
+    /* both buffers have to hold the longest record of this channel */
+    parr2 = &ps->arr2Channel[ch-1];
+    epicsMutexLock(ps->backLock);
+    epicsMutexLock(ps->acqLock);
+    parr2->users++;
+    if (parr2->bufSize < pwf->nelm){
+      LeCroy_Free_Raw(parr2->buffer);
+      LeCroy_Free_Raw(parr2->back);
+      parr2->buffer = LeCroy_Malloc_Raw(pwf->nelm);
+      parr2->back = LeCroy_Malloc_Raw(pwf->nelm);
+      if (parr2->buffer == NULL || parr2->back == NULL){
+	LeCroy_Free_Raw(parr2->buffer);
+	LeCroy_Free_Raw(parr2->back);
+	parr2->buffer = parr2->back = NULL;
+      }
+      parr2->bufSize = (parr2->buffer == NULL) ? 0 : pwf->nelm;
+      parr2->status = ERROR; /* nothing in new buffer yet */
+    }
+    epicsMutexUnlock(ps->acqLock);
+    epicsMutexUnlock(ps->backLock);
+    data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));
+    memset(data, 0, sizeof(DPVT_DATA));
+    data->deviceId = deviceId;
+    data->ps = ps;
+    pwf->dpvt=(void*)data;
+    return(0);
+  }
+
   /* Use dpvt to store task ID for async task */
-  DPVT_DATA* data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));
-  data->deviceId = GETWF;
-  data->bufSize = 0;
-  data->buffer = NULL;
+  data = (DPVT_DATA*) malloc(sizeof(DPVT_DATA));
+  memset(data, 0, sizeof(DPVT_DATA)); /* info of no read is never same as scope */
+  data->deviceId = deviceId;
+  data->ps = ps;
+  /* raw buffer for LeCroy_Read_Raw, NELM never changes */
+  data->buffer = LeCroy_Malloc_Raw(pwf->nelm);
+  data->bufSize = (data->buffer == NULL) ? 0 : pwf->nelm;
   pwf->dpvt=(void*)data;
   return(0);
 }
 
-static void handleWf(TASK_DATA* message)
+static void handleWf(TASK_DATA* message)
+{
+  int num, got, ch;
+  void* praw[TOTALCHNLS];
+  int pts[TOTALCHNLS];
+  LECROY_WFINFO info[TOTALCHNLS];
+  unsigned int same;
+  struct waveformRecord* pwf = (struct waveformRecord*) message->pRecord;
+  DPVT_DATA* dpvt = (DPVT_DATA*) pwf->dpvt;
+  SCOPE* ps = dpvt->ps;
+  int check = ps->wfCheck; /* wfcheckS may change it meanwhile */
+  int element = pwf->nelm; /* this is a static variable so there is no
+			      danger in initializing outside of a lock
+			      set */
+  ARR2_CHANNEL* parr2 = NULL;
+  if (dpvt->bufSize < element){
+    /* raw buffer only ever grows, it keeps its alignment */
+    LeCroy_Free_Raw(dpvt->buffer);
+    dpvt->buffer = LeCroy_Malloc_Raw(element);
+    dpvt->bufSize = (dpvt->buffer == NULL) ? 0 : element;
+  }
+  if (dpvt->buffer == NULL){
+    dbScanLock(message->pRecord);
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+    ((pwf->rset)->process)(message->pRecord);
+    dbScanUnlock(message->pRecord);
+    return;
+  }
+
+  /* samples go from socket right into raw buffer, outside of the lock set. */
+  /* With wfcheckS on, record keeps what it has if scope didn't acquire again */
+  ch = message->channel;
+  same = 0;
+  if (ch >= 1 && ch <= TOTALCHNLS && ps->arr2Channel[ch-1].users > 0)
+    parr2 = &ps->arr2Channel[ch-1];
+  if (ch < 1 || ch > TOTALCHNLS)
+    num = ERROR;
+  else if (parr2 != NULL){
+    /* both arrays with one WF?, second one into back buffer without */
+    /* acqLock, array2 records keep taking last one meanwhile          */
+    LECROY_ARRAYS arrays;
+
+    memset(&arrays, 0, sizeof(arrays));
+    epicsMutexLock(ps->backLock);
+    arrays.praw2 = parr2->back;
+    arrays.pts2 = parr2->bufSize;
+    num = LeCroy_Read_Arrays(message->scopeID, ch, dpvt->buffer, element, &arrays, &dpvt->info);
+    epicsMutexLock(ps->acqLock);
+    parr2->status = (num < 0) ? ERROR : OK;
+    if (num >= 0){
+      parr2->back = parr2->buffer;
+      parr2->buffer = arrays.praw2;
+      parr2->info = dpvt->info;
+      parr2->info.points = arrays.points2;
+    }
+    epicsMutexUnlock(ps->acqLock);
+    epicsMutexUnlock(ps->backLock);
+  }
+  else {
+    memset(praw, 0, sizeof(praw));
+    memset(pts, 0, sizeof(pts));
+    praw[ch-1] = dpvt->buffer;
+    pts[ch-1] = element;
+    info[ch-1] = dpvt->info;
+    same = (1 << (ch-1));
+    got = LeCroy_Read_Multi(message->scopeID, same, praw, pts, info, check ? &same : NULL);
+    if (got != ERROR && (got & (1 << (ch-1)))){
+      dpvt->info = info[ch-1];
+      num = dpvt->info.points;
+      same = 0;
+    }
+    else if (got != ERROR && check && same)
+      num = dpvt->info.points;
+    else
+      num = ERROR;
+  }
+
+  /* rest is CPU work, decode strand does it while we receive next one */
+  dpvt->points = num;
+  dpvt->same = (same != 0);
+  if (strandPost(&ps->decode, message) == ERROR)
+    decodeWf(message);
+}
+
+/* second stage of handleWf, samples of this record are in its raw buffer */
+static void decodeWf(TASK_DATA* message)
+{
+  struct waveformRecord* pwf = (struct waveformRecord*) message->pRecord;
+  int ch = message->channel;
+  DPVT_DATA* dpvt = (DPVT_DATA*) pwf->dpvt;
+  SCOPE* ps = dpvt->ps;
+  int num = dpvt->points;
+  int same = dpvt->same;
+  ARR2_CHANNEL* parr2 = NULL;
+
+  if (ch >= 1 && ch <= TOTALCHNLS && ps->arr2Channel[ch-1].users > 0)
+    parr2 = &ps->arr2Channel[ch-1];
+
+  dbScanLock(message->pRecord);
+
+  if (num < 0){
+    /* error condition or channel disabled */
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+    storeStat(pwf, ERROR, NULL, NULL);
+  }
+  else if (!same)
+    /* and from raw buffer right into the record, no staging copy */
+    num = storeWf(pwf, &dpvt->info, dpvt->buffer, num);
+  /* else same acquisition as last time, record has it already */
+
+  /* once record is processed scope strand may read into raw buffer */
+  /* again, so everything that needs it goes before                 */
+  if (num < 0)
+    dpvt->info.setup = 0; /* raw buffer or record doesn't have it, read again */
+
+  /* integrals of samples we just read, not again for same acquisition */
+  if (num < 0)
+    integrate(ps, ch, ERROR, NULL, NULL);
+  else if (!same)
+    integrate(ps, ch, OK, &dpvt->info, dpvt->buffer);
+
+  /* gain and offset records of this channel follow the last read */
+  if (ch >= 1 && ch <= MAX_CHANNELS){
+    ACQ_CHANNEL* pacq = &ps->acqChannel[ch-1];
+
+    epicsMutexLock(ps->acqLock);
+    pacq->lastStatus = (num < 0) ? ERROR : OK;
+    if (num >= 0)
+      pacq->lastInfo = dpvt->info;
+    epicsMutexUnlock(ps->acqLock);
+  }
+
+  if (parr2 != NULL)
+    scanIoRequest(parr2->scan);
+
+  ((pwf->rset)->process)(message->pRecord);
+
+  dbScanUnlock(message->pRecord);
+}
+
+/* first point and how many of a window, from start up to stop in seconds */
+/* from trigger or in points. Return FALSE if it has none of waveform     */
+static int roiWindow(const ROI_CHANNEL* proi, const LECROY_WFINFO* pinfo, double start, double stop, int* pfirst, int* ppts)
+{
+  if (proi->seconds){
+    if (pinfo->dt <= 0)
+      return FALSE;
+    start = (start - pinfo->t0) / pinfo->dt;
+    stop = (stop - pinfo->t0) / pinfo->dt;
+  }
+  /* don't let int overflow, LeCroy_Sum clips the rest */
+  if (start < 0)
+    start = 0;
+  if (stop > pinfo->points)
+    stop = pinfo->points;
+  if (stop <= start)
+    return FALSE;
+  *pfirst = (int) ceil(start);
+  *ppts = (int) ceil(stop) - *pfirst;
+  return (*ppts > 0);
+}
+
+/* gated integrals of what we just read, then their records. Called by */
+/* acquisition thread right after the read, status ERROR if it failed  */
+static void integrate(SCOPE* ps, int ch, int status, const LECROY_WFINFO* pinfo, const void* praw)
+{
+  ROI_CHANNEL* proi;
+  double sum;
+  int roi, first, pts;
+
+  if (ch < 1 || ch > MAX_CHANNELS)
+    return;
+  proi = &ps->roiChannel[ch-1];
+  if (proi->users <= 0)
+    return;
+
+  epicsMutexLock(ps->acqLock);
+  proi->baseStatus = status;
+  proi->baseline = 0;
+  if (status == OK && proi->basestop > proi->basestart){
+    if (roiWindow(proi, pinfo, proi->basestart, proi->basestop, &first, &pts) &&
+	(pts = LeCroy_Sum(pinfo, praw, first, pts, &sum)) > 0)
+      proi->baseline = sum / pts;
+    else
+      proi->baseStatus = ERROR; /* no baseline, so no integral is good */
+  }
+  for (roi = 0; roi < MAX_ROIS; roi++){
+    proi->status[roi] = proi->baseStatus;
+    if (proi->status[roi] != OK)
+      continue;
+    if (roiWindow(proi, pinfo, proi->start[roi], proi->stop[roi], &first, &pts) &&
+	(pts = LeCroy_Sum(pinfo, praw, first, pts, &sum)) > 0)
+      proi->integral[roi] = (sum - pts * proi->baseline) * pinfo->dt;
+    else
+      proi->status[roi] = ERROR; /* window is empty or out of waveform */
+  }
+  if (status == OK)
+    proi->info = *pinfo;
+  epicsMutexUnlock(ps->acqLock);
+
+  scanIoRequest(proi->scan);
+}
+
+/* samples to record as FTVL wants, volts for FLOAT, raw for CHAR and SHORT. */
+/* Raw is sample * GAINCHx - OFFSETCHx volts, so CA carries 1/4 or 1/2 bytes */
+static int storeWf(waveformRecord* pwf, const LECROY_WFINFO* pinfo, const void* praw, int pts)
+{
+  int num, ch = pwf->inp.value.vmeio.signal;
+  SCOPE* ps = ((DPVT_DATA*) pwf->dpvt)->ps;
+  LECROY_WFSTAT wfstat;
+  int stat = 0; /* work out statistics too */
+
+  if (((DPVT_DATA*) pwf->dpvt)->deviceId == GETWF && ch >= 1 && ch <= MAX_CHANNELS)
+    stat = (ps->acqChannel[ch-1].statUsers > 0);
+
+  switch (pwf->ftvl){
+  case DBF_CHAR:
+    num = LeCroy_Copy_Raw(pinfo, praw, pwf->bptr, 1, pts);
+    if (stat && num >= 0)
+      LeCroy_Convert_Stat(pinfo, praw, NULL, num, &wfstat);
+    break;
+  case DBF_SHORT:
+    num = LeCroy_Copy_Raw(pinfo, praw, pwf->bptr, 2, pts);
+    if (stat && num >= 0)
+      LeCroy_Convert_Stat(pinfo, praw, NULL, num, &wfstat);
+    break;
+  default:
+    /* statistics come with volts in one pass */
+    if (stat)
+      num = LeCroy_Convert_Stat(pinfo, praw, (float*)(pwf->bptr), pts, &wfstat);
+    else
+      num = LeCroy_Convert(pinfo, praw, (float*)(pwf->bptr), pts);
+  }
+  if (stat)
+    storeStat(pwf, (num < 0) ? ERROR : OK, pinfo, &wfstat);
+
+  if (num < 0)
+    /* e.g. 16 bits samples into CHAR */
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+  else {
+    pwf->nord = num;
+    trgTime((struct dbCommon*) pwf, pinfo);
+  }
+  return num;
+}
+
+/* statistics of what waveform record of channel just got, then their records */
+static void storeStat(waveformRecord* pwf, int status, const LECROY_WFINFO* pinfo, const LECROY_WFSTAT* pstat)
+{
+  SCOPE* ps = ((DPVT_DATA*) pwf->dpvt)->ps;
+  int ch = pwf->inp.value.vmeio.signal;
+  ACQ_CHANNEL* pacq;
+
+  if (((DPVT_DATA*) pwf->dpvt)->deviceId != GETWF || ch < 1 || ch > MAX_CHANNELS)
+    return;
+  pacq = &ps->acqChannel[ch-1];
+  if (pacq->statUsers <= 0)
+    return;
+  epicsMutexLock(ps->acqLock);
+  pacq->statStatus = status;
+  if (status == OK){
+    pacq->stat = *pstat;
+    pacq->statInfo = *pinfo;
+  }
+  epicsMutexUnlock(ps->acqLock);
+  scanIoRequest(pacq->statScan);
+}
+
+/* with TSE=-2 record time is trigger time, record support leaves it alone. */
+/* A record that skipped a transfer keeps the time of what it still has    */
+static void trgTime(struct dbCommon* prec, const LECROY_WFINFO* pinfo)
+{
+  if (prec->tse == epicsTimeEventDeviceTime)
+    prec->time = pinfo->trgtime;
+}
+
+/* all segments of a sequence with one WF?, then records of their times */
+static void handleSeq(TASK_DATA* message)
 {
-  int num;
+  int num, ch;
   struct waveformRecord* pwf = (struct waveformRecord*) message->pRecord;
-  int element = pwf->nelm; /* this is a static variable so there is no
-			      danger in initializing outside of a lock
-			      set */
+  int element = pwf->nelm;
   DPVT_DATA* dpvt = (DPVT_DATA*) pwf->dpvt;
-  if (dpvt->bufSize < element){
-    dpvt->bufSize = element;
-    dpvt->buffer = realloc(dpvt->buffer, dpvt->bufSize*sizeof(float));
-  }
-  if (dpvt->buffer == NULL){
-    pwf->pact = FALSE;
-    return;
+  SCOPE* ps = dpvt->ps;
+  SEQ_CHANNEL* pseq = NULL;
+
+  ch = message->channel;
+  if (ch >= 1 && ch <= MAX_CHANNELS && dpvt->buffer != NULL){
+    /* segment times arrive in back buffer without acqLock, */
+    /* seqtime records keep taking last ones meanwhile      */
+    LECROY_SEGTIME* psegtime;
+
+    pseq = &ps->seqChannel[ch-1];
+    epicsMutexLock(ps->backLock);
+    psegtime = pseq->back;
+    num = LeCroy_Read_Seg(message->scopeID, ch, dpvt->buffer, element,
+			  psegtime, pseq->maxseg, &dpvt->info);
+    epicsMutexLock(ps->acqLock);
+    pseq->status = (num < 0) ? ERROR : OK;
+    if (num >= 0){
+      pseq->back = pseq->segtime;
+      pseq->segtime = psegtime;
+      pseq->info = dpvt->info;
+    }
+    epicsMutexUnlock(ps->acqLock);
+    epicsMutexUnlock(ps->backLock);
   }
-
-  num = LeCroy_Read(message->scopeID, message->channel, dpvt->buffer, element);
+  else
+    num = ERROR;
 
   dbScanLock(message->pRecord);
 
   if (num < 0)
     /* error condition or channel disabled */
     recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
-  else {
-    memcpy((float*)(pwf->bptr), dpvt->buffer, num*sizeof(float));
-    pwf->nord = num;
-  }
+  else
+    num = storeWf(pwf, &dpvt->info, dpvt->buffer, num);
 
   ((pwf->rset)->process)(message->pRecord);
 
   dbScanUnlock(message->pRecord);
+
+  if (pseq != NULL)
+    scanIoRequest(pseq->scan);
+}
+
+/* TRIGGER_TIME or TRIGGER_OFFSET of each segment of last sequence read */
+static void storeSeqTime(waveformRecord* pwf, SCOPE* ps, int ch)
+{
+  DPVT_DATA* dpvt = (DPVT_DATA*) pwf->dpvt;
+  SEQ_CHANNEL* pseq = &ps->seqChannel[ch-1];
+  double* pval = (double*) pwf->bptr;
+  int loop, nseg;
+
+  epicsMutexLock(ps->acqLock);
+  if (pseq->status == OK){
+    nseg = pseq->info.segments;
+    if (nseg > pseq->maxseg)
+      nseg = pseq->maxseg;
+    if (nseg > pwf->nelm)
+      nseg = pwf->nelm;
+    for (loop = 0; loop < nseg; loop++)
+      pval[loop] = (dpvt->deviceId == LT_WF_SEQTIME) ?
+	pseq->segtime[loop].trgtime : pseq->segtime[loop].trgoffset;
+    pwf->nord = nseg;
+    trgTime((struct dbCommon*) pwf, &pseq->info);
+  }
+  else
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+  epicsMutexUnlock(ps->acqLock);
+}
+
+/* WAVE_ARRAY_2 of last read of channel, as FTVL wants like any waveform */
+static void storeArray2(waveformRecord* pwf, SCOPE* ps, int ch)
+{
+  ARR2_CHANNEL* parr2 = &ps->arr2Channel[ch-1];
+
+  epicsMutexLock(ps->acqLock);
+  if (parr2->status == OK && parr2->info.points > 0)
+    storeWf(pwf, &parr2->info, parr2->buffer, (parr2->info.points < pwf->nelm) ? parr2->info.points : pwf->nelm);
+  else
+    /* read failed or waveform has no second array */
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+  epicsMutexUnlock(ps->acqLock);
+}
+
+/* time axis of last read of channel. Record keeps the axis it has until  */
+/* t0, dt or points change, so a long one isn't rebuilt for every trigger */
+static void storeTime(waveformRecord* pwf, SCOPE* ps, int ch)
+{
+  DPVT_DATA* dpvt = (DPVT_DATA*) pwf->dpvt;
+  ACQ_CHANNEL* pacq = &ps->acqChannel[ch-1];
+  LECROY_WFINFO info;
+  int status;
+
+  /* like gain and offset records, same acquisition as waveforms on I/O Intr */
+  epicsMutexLock(ps->acqLock);
+  if (pwf->scan == SCAN_IO_EVENT){
+    status = pacq->status;
+    info = pacq->info;
+  }
+  else {
+    status = pacq->lastStatus;
+    info = pacq->lastInfo;
+  }
+  epicsMutexUnlock(ps->acqLock);
+
+  if (status != OK){
+    recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+    return;
+  }
+  if (info.points > pwf->nelm)
+    info.points = pwf->nelm;
+  if (info.t0 != dpvt->info.t0 || info.dt != dpvt->info.dt ||
+      info.points != dpvt->info.points || info.segments != dpvt->info.segments ||
+      info.segpoints != dpvt->info.segpoints){
+    pwf->nord = LeCroy_Time_Axis(&info, (double*)(pwf->bptr), info.points);
+    dpvt->info = info; /* record has the axis of it */
+  }
+  trgTime((struct dbCommon*) pwf, &info);
 }
 
 static long readWf(struct waveformRecord* pwf)
@@ -321,24 +1449,64 @@ static long readWf(struct waveformRecord* pwf)
   TASK_DATA message;
 
   if(!pwf->pact) { /* need to start async task */
+    DPVT_DATA*		dpvt = (DPVT_DATA*) pwf->dpvt;
+    SCOPE*		ps = dpvt->ps;
     struct vmeio 	*pvmeio;
     LeCroyID		ltid;
-    int		        ch, num, element;
+    int		        ch, element;
     
     pvmeio = (struct vmeio *) &(pwf->inp.value);
-    num = pvmeio->card;
     ch = pvmeio->signal;
-    ltid = scopeID[num];
+    if(ps == NULL) return 0;
+    ltid = ps->scopeID;
     element = pwf->nelm;
     if(!ltid) return 0;
 
+    if (dpvt->deviceId == LT_WF_SEQTIME || dpvt->deviceId == LT_WF_SEQOFFSET){
+      /* from the sequence read, channel is checked by initRecord */
+      storeSeqTime(pwf, ps, ch);
+      return(OK);
+    }
+
+    if (dpvt->deviceId == LT_WF_ARRAY2){
+      /* from the read of channel, channel is checked by initRecord */
+      storeArray2(pwf, ps, ch);
+      return(OK);
+    }
+
+    if (dpvt->deviceId == LT_WF_TIME){
+      /* from WAVEDESC of last read, channel is checked by initRecord */
+      storeTime(pwf, ps, ch);
+      return(OK);
+    }
+
+    if (pwf->scan == SCAN_IO_EVENT){
+      /* processed by acquire record, samples are already here */
+      ACQ_CHANNEL* pacq;
+
+      if (ch < 1 || ch > MAX_CHANNELS){
+	recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+	return(OK);
+      }
+      pacq = &ps->acqChannel[ch-1];
+      epicsMutexLock(ps->acqLock);
+      if (pacq->status == OK)
+	storeWf(pwf, &pacq->info, pacq->buffer, element);
+      else {
+	recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+	storeStat(pwf, ERROR, NULL, NULL);
+      }
+      epicsMutexUnlock(ps->acqLock);
+      return(OK);
+    }
+
     pwf->pact=TRUE;
 
     message.scopeID = ltid;
     message.channel = ch;
-    message.cmd = GETWF;
+    message.cmd = dpvt->deviceId; /* GETWF or LT_WF_SEQ */
     message.pRecord = (struct dbCommon*) pwf;
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(pwf, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
       pwf->pact = FALSE;
       return ERROR;
@@ -351,12 +1519,197 @@ static long readWf(struct waveformRecord* pwf)
   return(OK);
 }
 
+static long wfIoinitInfo(int cmd, waveformRecord* pwf, IOSCANPVT* iopvt)
+{
+  int ch;
+  SCOPE* ps;
+  ACQ_CHANNEL* pacq;
+
+  if (pwf->inp.type != VME_IO || pwf->dpvt == NULL)
+    return (S_db_badField);
+  ps = ((DPVT_DATA*) pwf->dpvt)->ps;
+  ch = pwf->inp.value.vmeio.signal;
+  if (((DPVT_DATA*) pwf->dpvt)->deviceId == LT_WF_ARRAY2 &&
+      ps != NULL && ch >= 1 && ch <= TOTALCHNLS){
+    /* processed after each read of channel, math traces too */
+    *iopvt = ps->arr2Channel[ch-1].scan;
+    return 0;
+  }
+  if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > MAX_CHANNELS){
+    recGblRecordError(S_db_badField, (void*)pwf,
+		      "devWfLT364 (wfIoinitInfo) Scope not initialized or bad channel");
+    return (S_db_badField);
+  }
+  switch (((DPVT_DATA*) pwf->dpvt)->deviceId){
+  case LT_WF_SEQ:
+    /* acquire record doesn't read sequences */
+    recGblRecordError(S_db_badField, (void*)pwf,
+		      "devWfLT364 (wfIoinitInfo) seq record can't be I/O Intr");
+    return (S_db_badField);
+  case LT_WF_SEQTIME:
+  case LT_WF_SEQOFFSET:
+    /* processed after each sequence read */
+    *iopvt = ps->seqChannel[ch-1].scan;
+    return 0;
+  case LT_WF_TIME:
+    /* comes with the waveforms, but doesn't need samples to be read */
+    *iopvt = ps->acqChannel[ch-1].scan;
+    return 0;
+  }
+  pacq = &ps->acqChannel[ch-1];
+
+  /* cmd 0 means record joins I/O Intr list, 1 means it leaves. */
+  /* Buffers may grow, so not while samples arrive in them      */
+  epicsMutexLock(ps->backLock);
+  epicsMutexLock(ps->acqLock);
+  if (cmd == 0){
+    pacq->users++;
+    if (pacq->bufSize < pwf->nelm){
+      /* both buffers have to hold the longest record of this channel */
+      LeCroy_Free_Raw(pacq->buffer);
+      LeCroy_Free_Raw(pacq->back);
+      pacq->buffer = LeCroy_Malloc_Raw(pwf->nelm);
+      pacq->back = LeCroy_Malloc_Raw(pwf->nelm);
+      if (pacq->buffer == NULL || pacq->back == NULL){
+	LeCroy_Free_Raw(pacq->buffer);
+	LeCroy_Free_Raw(pacq->back);
+	pacq->buffer = pacq->back = NULL;
+      }
+      pacq->bufSize = (pacq->buffer == NULL) ? 0 : pwf->nelm;
+      pacq->status = ERROR; /* new buffer has no samples yet */
+    }
+  }
+  else
+    pacq->users--;
+  epicsMutexUnlock(ps->acqLock);
+  epicsMutexUnlock(ps->backLock);
+
+  *iopvt = pacq->scan;
+  return 0;
+}
+
+/* read all channels somebody listens to, one query each with control lane */
+/* of strand run in between, then process them                             */
+static void handleAcquire(TASK_DATA* message)
+{
+  struct boRecord* bor = (struct boRecord*) message->pRecord;
+  SCOPE* ps = ((DPVT_DATA*) bor->dpvt)->ps;
+  void* praw[TOTALCHNLS];
+  int pts[TOTALCHNLS];
+  LECROY_WFINFO info[TOTALCHNLS];
+  unsigned int mask = 0;
+  unsigned int same = 0; /* channels with a good acquisition in buffer */
+  unsigned int left = 0; /* same of channels scope had nothing new for */
+  unsigned int one;
+  int check = ps->wfCheck; /* wfcheckS may change it meanwhile */
+  int got = 0, failed = 0, status, ch, first = -1;
+  int mixed = 0;
+
+  memset(praw, 0, sizeof(praw));
+  memset(pts, 0, sizeof(pts));
+
+  /* samples arrive in back buffers without acqLock, records */
+  /* keep converting last acquisition from front ones        */
+  epicsMutexLock(ps->backLock);
+  epicsMutexLock(ps->acqLock);
+  for (ch = 0; ch < MAX_CHANNELS; ch++){
+    if (ps->acqChannel[ch].users > 0 && ps->acqChannel[ch].back != NULL){
+      praw[ch] = ps->acqChannel[ch].back;
+      pts[ch] = ps->acqChannel[ch].bufSize;
+      mask |= (1 << ch);
+      if (check && ps->acqChannel[ch].status == OK){
+	info[ch] = ps->acqChannel[ch].info;
+	same |= (1 << ch);
+      }
+    }
+  }
+  epicsMutexUnlock(ps->acqLock);
+
+  /* setpoints and readbacks don't wait for all channels, only for one. */
+  /* Nothing they do touches back buffers                               */
+  for (ch = 0; ch < MAX_CHANNELS; ch++){
+    if (!(mask & (1 << ch)))
+      continue;
+    if (got | left | failed)
+      strandYield(ps);
+    one = same & (1 << ch);
+    status = LeCroy_Read_Multi(message->scopeID, (1 << ch), praw, pts, info, check ? &one : NULL);
+    if (status == ERROR)
+      failed |= (1 << ch); /* disabled too */
+    else {
+      got |= status;
+      left |= one;
+    }
+  }
+  same = left;
+
+  /* a trigger may come between two channels, then they are read again */
+  /* together, LeCroy_Read_Multi only returns those of one trigger      */
+  for (ch = 0; ch < MAX_CHANNELS; ch++){
+    if (!(got & (1 << ch)))
+      continue;
+    if (first < 0)
+      first = ch;
+    else if (!epicsTimeEqual(&info[ch].trgtime, &info[first].trgtime))
+      mixed = 1;
+  }
+  if (mixed){
+    status = LeCroy_Read_Multi(message->scopeID, got, praw, pts, info, NULL);
+    if (status == ERROR)
+      status = 0;
+    failed |= got & ~status;
+    got = status;
+  }
+
+  epicsMutexLock(ps->acqLock);
+  for (ch = 0; ch < MAX_CHANNELS; ch++){
+    if (got & (1 << ch)){
+      ps->acqChannel[ch].back = ps->acqChannel[ch].buffer;
+      ps->acqChannel[ch].buffer = praw[ch];
+      ps->acqChannel[ch].info = info[ch];
+      ps->acqChannel[ch].status = OK;
+      ps->acqChannel[ch].lastInfo = info[ch];
+    }
+    else if (!(same & (1 << ch)))
+      ps->acqChannel[ch].status = ERROR;
+    /* else scope has nothing new, buffer and info are still good */
+    if (mask & (1 << ch))
+      ps->acqChannel[ch].lastStatus = ps->acqChannel[ch].status;
+  }
+  epicsMutexUnlock(ps->acqLock);
+
+  /* every channel we asked for, so disabled ones go to alarm, also    */
+  /* gain and offset records of the channel are processed in this pass. */
+  /* Channels scope has nothing new for are left alone                 */
+  for (ch = 0; ch < MAX_CHANNELS; ch++)
+    if ((mask & ~same) & (1 << ch))
+      scanIoRequest(ps->acqChannel[ch].scan);
+
+  /* integrals of what we just read, nobody swaps buffers but us. Channels */
+  /* on I/O Intr only, others are read by their waveform record            */
+  for (ch = 0; ch < MAX_CHANNELS; ch++)
+    if ((mask & ~same) & (1 << ch))
+      integrate(ps, ch+1, ps->acqChannel[ch].status, &ps->acqChannel[ch].info, ps->acqChannel[ch].buffer);
+  epicsMutexUnlock(ps->backLock);
+
+  dbScanLock(message->pRecord);
+
+  if (failed != 0 && got == 0 && same == 0)
+    /* no channel came, like one query for all of them failing */
+    recGblSetSevr(bor, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+
+  ((bor->rset)->process)(message->pRecord);
+
+  dbScanUnlock(message->pRecord);
+}
+
 /***************************************************************************************/
 /**************************************  BO RECORD *************************************/
 /***************************************************************************************/
 static long initBo(struct boRecord *bor)
 {    
   DPVT_DATA* dpvt;
+  LeCroyID ltid;
   struct vmeio* pvmeio;
   int status=OK;
   int readback;
@@ -377,6 +1730,10 @@ static long initBo(struct boRecord *bor)
   CHECK_BOPARM("enblch4");
   CHECK_BOPARM("autocalS");
   CHECK_BOPARM("recoverlink");
+  CHECK_BOPARM("acquire");
+  CHECK_BOPARM("wfcheckS");
+  CHECK_BOPARM("srqS");
+  CHECK_BOPARM("roiunitS");
   
   if (!paramOK){
     recGblRecordError(S_db_badField, (void*)bor,
@@ -388,9 +1745,10 @@ static long initBo(struct boRecord *bor)
   /* initialize bo records with current readback value */
   pvmeio = (struct vmeio *)&(bor->out.value);
   dpvt = (DPVT_DATA*) bor->dpvt;
+  ltid = (dpvt->ps != NULL) ? dpvt->ps->scopeID : NULL;
   switch (dpvt->deviceId){
   case LT_BO_ENBLCH:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETCHANSTAT, &readback);
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETCHANSTAT, &readback);
     if (status == OK){
       /* note: 0=off 1=on but rval implies the opposite */
       bor->rval=(readback-1)*(readback-1); /* this is
@@ -401,7 +1759,7 @@ static long initBo(struct boRecord *bor)
       bor->udf = TRUE;
     break;
   case LT_BO_AUTOCAL:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETACALSTAT, &readback);
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETACALSTAT, &readback);
     if (status == OK){
       bor->rval=(readback-1)*(readback-1);
       bor->udf = FALSE;
@@ -409,8 +1767,26 @@ static long initBo(struct boRecord *bor)
     else
       bor->udf = TRUE;
     break;
+  case LT_BO_SRQ:
+    status = LeCroy_Ioctl(ltid, 0, GETSRQSTAT, &readback);
+    if (status == OK){
+      bor->rval = readback;
+      bor->udf = FALSE;
+    }
+    else
+      bor->udf = TRUE;
+    break;
+  case LT_BO_WFCHECK:
+    /* PINI gives the default, see template */
+    bor->val = (dpvt->ps != NULL) ? dpvt->ps->wfCheck : 0;
+    bor->udf = FALSE;
+    return (2); /* don't convert, val is good */
+  case LT_BO_ROIUNIT:
+    /* PINI gives the default, see template */
+    return (2);
   case LT_BO_RESET:
   case LT_BO_RECOVER:
+  case LT_BO_ACQUIRE:
     /* nothing to initialize */
     break;
   }
@@ -426,7 +1802,7 @@ static long writeBo(struct boRecord *bor)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
     
     switch (bor->out.type) {
     case (VME_IO) :
@@ -439,15 +1815,33 @@ static long writeBo(struct boRecord *bor)
     }
   
     /* Need IP for Scope - this comes from combination of card # and signal */
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)bor,
 			"devBoLT364 (writeBo) Scope not connected");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
+
+    if (dpvt->deviceId == LT_BO_WFCHECK){
+      /* nothing goes to scope, next read picks it up */
+      ps->wfCheck = (bor->val != 0);
+      return (OK);
+    }
+
+    if (dpvt->deviceId == LT_BO_ROIUNIT){
+      /* windows of channel, next read picks it up */
+      if (pvmeio->signal < 1 || pvmeio->signal > MAX_CHANNELS){
+	recGblSetSevr(bor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
+	return (OK);
+      }
+      epicsMutexLock(ps->acqLock);
+      ps->roiChannel[pvmeio->signal-1].seconds = (bor->val != 0);
+      epicsMutexUnlock(ps->acqLock);
+      return (OK);
+    }
 
     bor->pact=TRUE;
     
@@ -461,6 +1855,9 @@ static long writeBo(struct boRecord *bor)
     case LT_BO_RECOVER:
       message.cmd = LT_BO_RECOVER;
       break;
+    case LT_BO_ACQUIRE:
+      message.cmd = LT_BO_ACQUIRE;
+      break;
     case LT_BO_ENBLCH:
       if (bor->rval == 0)
 	message.cmd = ENABLECHAN;
@@ -477,6 +1874,9 @@ static long writeBo(struct boRecord *bor)
       else
 	status = ERROR;
       break;
+    case LT_BO_SRQ:
+      message.cmd = bor->val ? ENABLESRQ : DISABLESRQ;
+      break;
     default:
       status = ERROR;
     };
@@ -486,7 +1886,7 @@ static long writeBo(struct boRecord *bor)
     
     message.pRecord = (struct dbCommon*) bor;
     
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(bor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
       bor->pact = FALSE;
       return ERROR;
@@ -499,6 +1899,27 @@ static long writeBo(struct boRecord *bor)
   return (OK);
 }
 
+/* only acquire record can be on I/O Intr, it is processed on service request */
+static long boIoinitInfo(int cmd, boRecord* bor, IOSCANPVT* iopvt)
+{
+  DPVT_DATA* dpvt = (DPVT_DATA*) (bor->dpvt);
+  SCOPE* ps = (dpvt != NULL) ? dpvt->ps : NULL;
+
+  if (dpvt == NULL || dpvt->deviceId != LT_BO_ACQUIRE || ps == NULL){
+    recGblRecordError(S_db_badField, (void*)bor,
+		      "devBoLT364 (boIoinitInfo) only acquire can be I/O Intr");
+    return (S_db_badField);
+  }
+  /* cmd 0 means record joins I/O Intr list, 1 means it leaves */
+  epicsMutexLock(strandLock);
+  ps->srqUsers += (cmd == 0) ? 1 : -1;
+  epicsMutexUnlock(strandLock);
+  srqWake();
+
+  *iopvt = ps->srqScan;
+  return 0;
+}
+
 static void handleEnableDisable(TASK_DATA* message)
 {
   int dummy  = 0;
@@ -543,7 +1964,7 @@ static void handleBo(TASK_DATA* message)
 /***************************************************************************************/
 static long biIoinitInfo(int cmd, biRecord* bir, IOSCANPVT* iopvt)
 {
-  return 0;
+  return statusIoinitInfo(cmd, (struct dbCommon*)bir, &bir->inp, iopvt);
 }
 
 static long initBi(struct biRecord *bir)
@@ -578,7 +1999,7 @@ static long readBi(struct biRecord* bir)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
     
     /* bi.inp must be a VME_IO */
     switch (bir->inp.type) {
@@ -592,15 +2013,30 @@ static long readBi(struct biRecord* bir)
     }
     
     /* Need IP for Scope - this comes from combination of card # and signal */
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)bir,
 			"devBoLT364 (readBi) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
+
+    if (bir->scan == SCAN_IO_EVENT){
+      /* processed by status poll, value is already here */
+      LECROY_STATUS scopestat;
+
+      if (getStatus(ps, &scopestat) == ERROR)
+	recGblSetSevr(bir, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else if (dpvt->deviceId == LT_BI_AUTOCAL)
+	bir->rval = scopestat.acalstat;
+      else if (pvmeio->signal >= 1 && pvmeio->signal <= STATUS_CHNLS)
+	bir->rval = scopestat.chanstat[pvmeio->signal-1];
+      else
+	recGblSetSevr(bir, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      return (OK);
+    }
     
     bir->pact = TRUE;
     
@@ -624,7 +2060,7 @@ static long readBi(struct biRecord* bir)
     
     message.pRecord = (struct dbCommon*) bir;
     
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(bir, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
       bir->pact = FALSE;
       return ERROR;
@@ -662,7 +2098,7 @@ static void handleBi(TASK_DATA* message)
 /***************************************************************************************/
 static long mbbiIoinitInfo(int cmd, mbbiRecord* mbbir, IOSCANPVT* iopvt)
 {
-  return 0;
+  return statusIoinitInfo(cmd, (struct dbCommon*)mbbir, &mbbir->inp, iopvt);
 }
 
 static void setbiMemSizeLegalValues(struct mbbiRecord* mbbir)
@@ -730,22 +2166,37 @@ static long readMbbi(struct mbbiRecord* mbbir)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID ltid;
-    int num;
+    SCOPE*   ps;
     /* must be a VME_IO */
     if (mbbir->inp.type!=VME_IO){
       recGblRecordError(S_db_badField, (void*)mbbir, "devMbbiLT364 (readMbbi) Illegal INP field");
       return(S_db_badField);
     }
     pvmeio = (struct vmeio*)&(mbbir->inp.value);
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)mbbir,
 			"devBoLT364 (readMbbi) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
+
+    if (mbbir->scan == SCAN_IO_EVENT && dpvt->deviceId != LT_MBBI_LINKSTATUS){
+      /* processed by status poll, value is already here */
+      LECROY_STATUS scopestat;
+
+      if (getStatus(ps, &scopestat) == ERROR)
+	recGblSetSevr(mbbir, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else if (dpvt->deviceId == LT_MBBI_MEMSZ)
+	mbbir->rval = scopestat.memsize;
+      else if (dpvt->deviceId == LT_MBBI_TRGMD)
+	mbbir->rval = scopestat.trgmode;
+      else
+	mbbir->rval = scopestat.trgsrc;
+      return (OK);
+    }
     
     mbbir->pact = TRUE;
 
@@ -777,7 +2228,7 @@ static long readMbbi(struct mbbiRecord* mbbir)
 
     message.pRecord = (struct dbCommon*) mbbir;
     if (message.cmd != LT_MBBI_LINKSTATUS){
-      if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+      if( strandPost( &ps->strand, &message) == ERROR){
 	recGblSetSevr(mbbir, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
 	mbbir->pact = FALSE;
 	return ERROR;
@@ -855,6 +2306,7 @@ static void setboMemSizeLegalValues(struct mbboRecord* mbbor)
 static long initMbbo(struct mbboRecord* mbbor)
 {
   DPVT_DATA* dpvt;
+  LeCroyID ltid;
   struct vmeio* pvmeio;
   int value, index;
   int paramOK=0;
@@ -876,6 +2328,7 @@ static long initMbbo(struct mbboRecord* mbbor)
   CHECK_MBBOPARM("trgsrcS");
   CHECK_MBBOPARM("ldpnlstp");
   CHECK_MBBOPARM("svpnlstp");
+  CHECK_MBBOPARM("formatS");
 
   if (!paramOK){
     recGblRecordError(S_db_badField, (void*)mbbor,
@@ -887,9 +2340,10 @@ static long initMbbo(struct mbboRecord* mbbor)
   /* initialize values to readbacks */
   pvmeio = (struct vmeio *)&(mbbor->out.value);
   dpvt = (DPVT_DATA*) mbbor->dpvt;
+  ltid = (dpvt->ps != NULL) ? dpvt->ps->scopeID : NULL;
   switch (dpvt->deviceId){
   case LT_MBBO_MEMSZ:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETMEMSIZE, &value);
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETMEMSIZE, &value);
     /* Ioctl returns the actual mem size - need to convert to rval
        index */
     for (index=0;index<15;index++)
@@ -899,10 +2353,14 @@ static long initMbbo(struct mbboRecord* mbbor)
       }
     break;
   case LT_MBBO_TRGMD:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETTRGMODE, &value);
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETTRGMODE, &value);
     break;
   case LT_MBBO_TRGSRC:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETTRGSRC, &value);
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETTRGSRC, &value);
+    break;
+  case LT_MBBO_FORMAT:
+    /* what init_LT364 asked for, so PINI doesn't switch it back */
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETFORMAT, &value);
     break;
   case LT_MBBO_LDPNLSTP:
     /* nothing to initialize */
@@ -934,7 +2392,7 @@ static long writeMbbo(struct mbboRecord* mbbor)
     struct vmeio* pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
 
     if (mbbor->out.type!=VME_IO){
       recGblRecordError(S_db_badField, (void*) mbbor,
@@ -946,15 +2404,15 @@ static long writeMbbo(struct mbboRecord* mbbor)
     /* Need IP for Scope - this comes from combination of card # and
        signal */
     pvmeio = (struct vmeio *)&(mbbor->out.value);
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)mbbor,
 			"devMbboLT364 (writeMbbo) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
 
     mbbor->pact = TRUE;
 
@@ -978,6 +2436,9 @@ static long writeMbbo(struct mbboRecord* mbbor)
     case LT_MBBO_SVPNLSTP :
       message.cmd = SVPNLSTP;
       break;
+    case LT_MBBO_FORMAT :
+      message.cmd = SETFORMAT;
+      break;
     default:
       status = ERROR;
     };
@@ -987,7 +2448,7 @@ static long writeMbbo(struct mbboRecord* mbbor)
     
     message.pRecord = (struct dbCommon*) mbbor;
 
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(mbbor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
       mbbor->pact = FALSE;
       return ERROR;
@@ -1027,6 +2488,7 @@ static long initAo(struct aoRecord *aor)
   int paramOK=0;
   int status = OK;
   DPVT_DATA* dpvt;
+  LeCroyID ltid;
   float value;
   struct vmeio* pvmeio;
   
@@ -1043,6 +2505,17 @@ static long initAo(struct aoRecord *aor)
   CHECK_AOPARM("voltdivch2S");
   CHECK_AOPARM("voltdivch3S");
   CHECK_AOPARM("voltdivch4S");
+  CHECK_AOPARM("trgoffsetS");
+  CHECK_AOPARM("basestartS");
+  CHECK_AOPARM("basestopS");
+  CHECK_AOPARM("roi1startS");
+  CHECK_AOPARM("roi2startS");
+  CHECK_AOPARM("roi3startS");
+  CHECK_AOPARM("roi4startS");
+  CHECK_AOPARM("roi1stopS");
+  CHECK_AOPARM("roi2stopS");
+  CHECK_AOPARM("roi3stopS");
+  CHECK_AOPARM("roi4stopS");
 
   if (!paramOK){
     recGblRecordError(S_db_badField, (void*)aor,
@@ -1054,13 +2527,25 @@ static long initAo(struct aoRecord *aor)
   /* initialize the record */
   pvmeio = (struct vmeio *)&(aor->out.value);
   dpvt = (DPVT_DATA*) aor->dpvt;
+  ltid = (dpvt->ps != NULL) ? dpvt->ps->scopeID : NULL;
   switch (dpvt->deviceId){
   case LT_AO_TIMEDIV:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETTIMEDIV, &value);  
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETTIMEDIV, &value);  
     break;
   case LT_AO_VOLTDIV:
-    status = LeCroy_Ioctl(scopeID[pvmeio->card], pvmeio->signal, GETVOLTDIV, &value);  
+    status = LeCroy_Ioctl(ltid, pvmeio->signal, GETVOLTDIV, &value);  
     break;
+  case LT_AO_TRGOFFSET:
+    /* PINI gives the default, see template. A double, float won't hold ns */
+    if (LeCroy_Get_TrgOffset(ltid, &aor->val) == OK)
+      aor->udf = FALSE;
+    return (2);
+  case LT_AO_ROISTART:
+  case LT_AO_ROISTOP:
+  case LT_AO_BASESTART:
+  case LT_AO_BASESTOP:
+    /* PINI gives the default, see template */
+    return (2);
   }
   if (status == OK){
     aor->val = value;
@@ -1084,7 +2569,7 @@ static long writeAo(struct aoRecord *aor)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
 
     switch (aor->out.type){
     case (VME_IO) :
@@ -1098,15 +2583,53 @@ static long writeAo(struct aoRecord *aor)
     }
   
     /* Need IP for Scope - this comes from combination of card # and signal */
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)aor,
 			"devAoLT364 (writeAo) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
+
+    if (dpvt->deviceId == LT_AO_TRGOFFSET){
+      /* nothing goes to scope, next read picks it up */
+      if (LeCroy_Set_TrgOffset(ltid, aor->val) == ERROR)
+	recGblSetSevr(aor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
+      aor->udf = FALSE;
+      return (2);
+    }
+
+    if (ROI_AO(dpvt->deviceId)){
+      /* windows of channel, next read picks it up */
+      ROI_CHANNEL* proi;
+
+      if (pvmeio->signal < 1 || pvmeio->signal > MAX_CHANNELS ||
+	  ((dpvt->deviceId == LT_AO_ROISTART || dpvt->deviceId == LT_AO_ROISTOP) &&
+	   (dpvt->index < 0 || dpvt->index >= MAX_ROIS))){
+	recGblSetSevr(aor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
+	return (2);
+      }
+      proi = &ps->roiChannel[pvmeio->signal-1];
+      epicsMutexLock(ps->acqLock);
+      switch (dpvt->deviceId){
+      case LT_AO_ROISTART:
+	proi->start[dpvt->index] = aor->val;
+	break;
+      case LT_AO_ROISTOP:
+	proi->stop[dpvt->index] = aor->val;
+	break;
+      case LT_AO_BASESTART:
+	proi->basestart = aor->val;
+	break;
+      default:
+	proi->basestop = aor->val;
+      }
+      epicsMutexUnlock(ps->acqLock);
+      aor->udf = FALSE;
+      return (2);
+    }
 
     aor->pact = TRUE;
 
@@ -1129,7 +2652,7 @@ static long writeAo(struct aoRecord *aor)
       return(ERROR);
 
     message.pRecord = (struct dbCommon*)aor;
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(aor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
       aor->pact = FALSE;
       return ERROR;
@@ -1170,9 +2693,67 @@ static void handleAo(TASK_DATA* message)
 /***************************************************************************************/
 static long aiIoinitInfo(int cmd, aiRecord* air, IOSCANPVT* iopvt)
 {
+  DPVT_DATA* dpvt = (DPVT_DATA*) (air->dpvt);
+  SCOPE* ps = dpvt->ps;
+  int ch;
+
+  if (!WFINFO_AI(dpvt->deviceId) && !WFSTAT_AI(dpvt->deviceId) && !ROI_AI(dpvt->deviceId))
+    return statusIoinitInfo(cmd, (struct dbCommon*)air, &air->inp, iopvt);
+
+  /* gain, offset, t0 and dt come with the waveform, so join its channel's list */
+  /* but don't count as user, they don't need samples to be read */
+  ch = air->inp.value.vmeio.signal;
+  if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > MAX_CHANNELS){
+    recGblRecordError(S_db_badField, (void*)air,
+		      "devAiLT364 (aiIoinitInfo) Scope not initialized or bad channel");
+    return (S_db_badField);
+  }
+  /* statistics records are processed after waveform record converted it */
+  if (WFSTAT_AI(dpvt->deviceId))
+    *iopvt = ps->acqChannel[ch-1].statScan;
+  else if (ROI_AI(dpvt->deviceId))
+    *iopvt = ps->roiChannel[ch-1].scan;
+  else
+    *iopvt = ps->acqChannel[ch-1].scan;
   return 0;
 }
 
+/* statistics of a channel are only worked out if somebody wants them */
+static void statUser(aiRecord* air)
+{
+  SCOPE* ps = ((DPVT_DATA*) air->dpvt)->ps;
+  int ch = air->inp.value.vmeio.signal;
+
+  if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > MAX_CHANNELS)
+    return; /* readAi and aiIoinitInfo complain */
+  epicsMutexLock(ps->acqLock);
+  ps->acqChannel[ch-1].statUsers++;
+  epicsMutexUnlock(ps->acqLock);
+}
+
+/* ROI of "roiN..." parm, from 0, -1 for other parms */
+static int roiIndex(const char* parm)
+{
+  int index;
+
+  if (sscanf(parm, "roi%d", &index) == 1)
+    return index-1;
+  return -1;
+}
+
+/* integrals of a channel are only worked out if somebody wants them */
+static void roiUser(aiRecord* air)
+{
+  SCOPE* ps = ((DPVT_DATA*) air->dpvt)->ps;
+  int ch = air->inp.value.vmeio.signal;
+
+  if (ps == NULL || ps->acqLock == NULL || ch < 1 || ch > MAX_CHANNELS)
+    return; /* readAi and aiIoinitInfo complain */
+  epicsMutexLock(ps->acqLock);
+  ps->roiChannel[ch-1].users++;
+  epicsMutexUnlock(ps->acqLock);
+}
+
 static long initAi(struct aiRecord *air)
 {
   switch (air->inp.type){
@@ -1182,6 +2763,54 @@ static long initAi(struct aiRecord *air)
     CHECK_AIPARM("voltdivch2M");
     CHECK_AIPARM("voltdivch3M");
     CHECK_AIPARM("voltdivch4M");
+    CHECK_AIPARM("gainch1M");
+    CHECK_AIPARM("gainch2M");
+    CHECK_AIPARM("gainch3M");
+    CHECK_AIPARM("gainch4M");
+    CHECK_AIPARM("offsetch1M");
+    CHECK_AIPARM("offsetch2M");
+    CHECK_AIPARM("offsetch3M");
+    CHECK_AIPARM("offsetch4M");
+    CHECK_AIPARM("t0ch1M");
+    CHECK_AIPARM("t0ch2M");
+    CHECK_AIPARM("t0ch3M");
+    CHECK_AIPARM("t0ch4M");
+    CHECK_AIPARM("dtch1M");
+    CHECK_AIPARM("dtch2M");
+    CHECK_AIPARM("dtch3M");
+    CHECK_AIPARM("dtch4M");
+    CHECK_AIPARM("minch1M");
+    CHECK_AIPARM("minch2M");
+    CHECK_AIPARM("minch3M");
+    CHECK_AIPARM("minch4M");
+    CHECK_AIPARM("maxch1M");
+    CHECK_AIPARM("maxch2M");
+    CHECK_AIPARM("maxch3M");
+    CHECK_AIPARM("maxch4M");
+    CHECK_AIPARM("meanch1M");
+    CHECK_AIPARM("meanch2M");
+    CHECK_AIPARM("meanch3M");
+    CHECK_AIPARM("meanch4M");
+    CHECK_AIPARM("rmsch1M");
+    CHECK_AIPARM("rmsch2M");
+    CHECK_AIPARM("rmsch3M");
+    CHECK_AIPARM("rmsch4M");
+    CHECK_AIPARM("areach1M");
+    CHECK_AIPARM("areach2M");
+    CHECK_AIPARM("areach3M");
+    CHECK_AIPARM("areach4M");
+    CHECK_AIPARM("peakch1M");
+    CHECK_AIPARM("peakch2M");
+    CHECK_AIPARM("peakch3M");
+    CHECK_AIPARM("peakch4M");
+    CHECK_AIPARM("roi1M");
+    CHECK_AIPARM("roi2M");
+    CHECK_AIPARM("roi3M");
+    CHECK_AIPARM("roi4M");
+    CHECK_AIPARM("roibaseM");
+    CHECK_AIPARM("wfreadM");
+    CHECK_AIPARM("wfskipM");
+    CHECK_AIPARM("wfskipratioM");
     /* Only gets here if a problem */
     recGblRecordError(S_db_badField, (void*)air,
 		      "devAiLT364 initAi - bad parameter");
@@ -1206,7 +2835,7 @@ static long readAi(struct aiRecord* air)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
 
     /* ai must be a VME_IO */
     switch (air->inp.type) {
@@ -1220,15 +2849,152 @@ static long readAi(struct aiRecord* air)
     }
 
     /* Need IP for Scope - this comes from combination of card # and signal */
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)air,
 			"devAiLT364 (readAi) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
+
+    if (WFINFO_AI(dpvt->deviceId)){
+      /* from WAVEDESC of this channel's waveform, nothing to ask the scope. */
+      /* On I/O Intr it is same acquisition as the waveforms of this pass */
+      ACQ_CHANNEL* pacq;
+      LECROY_WFINFO* pinfo;
+
+      if (pvmeio->signal < 1 || pvmeio->signal > MAX_CHANNELS){
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+	return (2);
+      }
+      pacq = &ps->acqChannel[pvmeio->signal-1];
+      epicsMutexLock(ps->acqLock);
+      if (air->scan == SCAN_IO_EVENT)
+	pinfo = (pacq->status == OK) ? &pacq->info : NULL;
+      else
+	pinfo = (pacq->lastStatus == OK) ? &pacq->lastInfo : NULL;
+      if (pinfo == NULL)
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else if (dpvt->deviceId == LT_AI_GAIN)
+	air->val = pinfo->gain;
+      else if (dpvt->deviceId == LT_AI_OFFSET)
+	air->val = pinfo->offset;
+      else if (dpvt->deviceId == LT_AI_T0)
+	air->val = pinfo->t0;
+      else
+	air->val = pinfo->dt;
+      if (pinfo != NULL)
+	trgTime((struct dbCommon*) air, pinfo);
+      epicsMutexUnlock(ps->acqLock);
+      air->udf = FALSE;
+      return (2); /* don't convert value because it is a double */
+    }
+
+    if (WFSTAT_AI(dpvt->deviceId)){
+      /* worked out when waveform record of channel converted it */
+      ACQ_CHANNEL* pacq;
+
+      if (pvmeio->signal < 1 || pvmeio->signal > MAX_CHANNELS){
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+	return (2);
+      }
+      pacq = &ps->acqChannel[pvmeio->signal-1];
+      epicsMutexLock(ps->acqLock);
+      if (pacq->statStatus != OK)
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else {
+	switch (dpvt->deviceId){
+	case LT_AI_MIN:
+	  air->val = pacq->stat.min;
+	  break;
+	case LT_AI_MAX:
+	  air->val = pacq->stat.max;
+	  break;
+	case LT_AI_MEAN:
+	  air->val = pacq->stat.mean;
+	  break;
+	case LT_AI_RMS:
+	  air->val = pacq->stat.rms;
+	  break;
+	case LT_AI_AREA:
+	  air->val = pacq->stat.area;
+	  break;
+	default:
+	  air->val = pacq->stat.peak;
+	}
+	trgTime((struct dbCommon*) air, &pacq->statInfo);
+      }
+      epicsMutexUnlock(ps->acqLock);
+      air->udf = FALSE;
+      return (2); /* don't convert value because it is a double */
+    }
+
+    if (ROI_AI(dpvt->deviceId)){
+      /* worked out right after the read of channel */
+      ROI_CHANNEL* proi;
+      int status;
+
+      if (pvmeio->signal < 1 || pvmeio->signal > MAX_CHANNELS ||
+	  (dpvt->deviceId == LT_AI_ROI && (dpvt->index < 0 || dpvt->index >= MAX_ROIS))){
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+	return (2);
+      }
+      proi = &ps->roiChannel[pvmeio->signal-1];
+      epicsMutexLock(ps->acqLock);
+      if (dpvt->deviceId == LT_AI_ROI){
+	status = proi->status[dpvt->index];
+	air->val = proi->integral[dpvt->index];
+      }
+      else {
+	status = proi->baseStatus;
+	air->val = proi->baseline;
+      }
+      if (status != OK)
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else
+	trgTime((struct dbCommon*) air, &proi->info);
+      epicsMutexUnlock(ps->acqLock);
+      air->udf = FALSE;
+      return (2); /* don't convert value because it is a double */
+    }
+
+    if (STATS_AI(dpvt->deviceId)){
+      /* traffic counters, status poll keeps a copy, on I/O Intr or not */
+      LECROY_STATS stats;
+      unsigned int wanted;
+
+      epicsMutexLock(ps->statusLock);
+      stats = ps->scopeStats;
+      epicsMutexUnlock(ps->statusLock);
+      /* waveforms transferred plus those we didn't have to */
+      wanted = stats.waveforms + stats.skipped;
+      if (dpvt->deviceId == LT_AI_WFREAD)
+	air->val = stats.waveforms;
+      else if (dpvt->deviceId == LT_AI_WFSKIP)
+	air->val = stats.skipped;
+      else
+	air->val = wanted ? 100.0 * stats.skipped / wanted : 0.0;
+      air->udf = FALSE;
+      return (2); /* don't convert value because it is a double */
+    }
+
+    if (air->scan == SCAN_IO_EVENT){
+      /* processed by status poll, value is already here */
+      LECROY_STATUS scopestat;
+
+      if (getStatus(ps, &scopestat) == ERROR)
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      else if (dpvt->deviceId == LT_AI_TIMEDIV)
+	air->val = scopestat.timediv;
+      else if (pvmeio->signal >= 1 && pvmeio->signal <= STATUS_CHNLS)
+	air->val = scopestat.voltdiv[pvmeio->signal-1];
+      else
+	recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
+      air->udf = FALSE;
+      return (2); /* don't convert value because it is a double */
+    }
 
     air->pact = TRUE;
 
@@ -1252,7 +3018,7 @@ static long readAi(struct aiRecord* air)
     }
     
     message.pRecord = (struct dbCommon*) air;
-    if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+    if( strandPost( &ps->strand, &message) == ERROR){
       recGblSetSevr(air, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
       air->pact = FALSE;
       return ERROR;
@@ -1288,6 +3054,139 @@ static void handleAi(TASK_DATA* message)
   dbScanUnlock(message->pRecord);  
 }
 
+/***************************************************************************************/
+/************************************  LONGOUT RECORD **********************************/
+/***************************************************************************************/
+/* WFSU of one channel, -1 (WFSU_AUTO) works it out from NELM of waveform records */
+static long initLo(struct longoutRecord *lor)
+{
+  DPVT_DATA* dpvt;
+  LeCroyID ltid;
+  LECROY_WFSU wfsu;
+  int paramOK=0;
+
+  if (lor->out.type!=VME_IO){
+    recGblRecordError(S_db_badField, (void*) lor,
+		      "devLoLT364 initLo - Illegal OUT");
+    lor->pact=TRUE;
+    return (S_db_badField);
+  }
+
+  CHECK_LOPARM("sparsingch1");
+  CHECK_LOPARM("sparsingch2");
+  CHECK_LOPARM("sparsingch3");
+  CHECK_LOPARM("sparsingch4");
+  CHECK_LOPARM("npointsch1");
+  CHECK_LOPARM("npointsch2");
+  CHECK_LOPARM("npointsch3");
+  CHECK_LOPARM("npointsch4");
+  CHECK_LOPARM("firstpntch1");
+  CHECK_LOPARM("firstpntch2");
+  CHECK_LOPARM("firstpntch3");
+  CHECK_LOPARM("firstpntch4");
+
+  if (!paramOK){
+    recGblRecordError(S_db_badField, (void*)lor,
+		      "devLoLT364 initLo - bad parameter");
+    lor->pact=TRUE;
+    return (S_db_badField);
+  }
+
+  /* initialize value to what driver has, unless database gives one with PINI */
+  dpvt = (DPVT_DATA*) lor->dpvt;
+  ltid = (dpvt->ps != NULL) ? dpvt->ps->scopeID : NULL;
+  if (lor->pini || LeCroy_Get_Wfsu(ltid, lor->out.value.vmeio.signal, &wfsu) == ERROR)
+    return (0);
+  switch (dpvt->deviceId){
+  case LT_LO_SPARSING:
+    lor->val = wfsu.sparsing;
+    break;
+  case LT_LO_NPOINTS:
+    lor->val = wfsu.npoints;
+    break;
+  case LT_LO_FIRSTPNT:
+    lor->val = wfsu.firstpoint;
+    break;
+  }
+  lor->udf = FALSE;
+  return (0);
+}
+
+static long writeLo(struct longoutRecord *lor)
+{
+  TASK_DATA message;
+  DPVT_DATA* dpvt = (DPVT_DATA*) (lor->dpvt);
+
+  if(!lor->pact) { /* need to start async task */
+    struct vmeio* pvmeio;
+    LeCroyID     ltid;
+    SCOPE*            ps;
+
+    pvmeio = (struct vmeio *)&(lor->out.value);
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
+    if (ltid == 0){
+      recGblRecordError(S_db_badField,(void *)lor,
+			"devLoLT364 (writeLo) Scope not connected?");
+      return(S_db_badField);
+    }
+    if (ps->status == ERROR)
+      return ps->status;
+
+    lor->pact = TRUE;
+
+    /* setup the message and send to the queue, so it doesn't change in the middle of a read */
+    message.scopeID = ltid;
+    message.channel = pvmeio->signal;
+    message.cmd = dpvt->deviceId;
+    message.pRecord = (struct dbCommon*) lor;
+
+    if( strandPost( &ps->strand, &message) == ERROR){
+      recGblSetSevr(lor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
+      lor->pact = FALSE;
+      return ERROR;
+    }
+    return (OK);
+  }
+
+  /* all done now */
+  lor->pact = FALSE;
+  return (OK);
+}
+
+static void handleLo(TASK_DATA* message)
+{
+  int status;
+  LECROY_WFSU wfsu;
+  struct longoutRecord* lor = (struct longoutRecord*) message->pRecord;
+
+  status = LeCroy_Get_Wfsu(message->scopeID, message->channel, &wfsu);
+  if (status == OK){
+    switch (message->cmd){
+    case LT_LO_SPARSING:
+      wfsu.sparsing = lor->val;
+      break;
+    case LT_LO_NPOINTS:
+      wfsu.npoints = lor->val;
+      break;
+    case LT_LO_FIRSTPNT:
+      wfsu.firstpoint = lor->val;
+      break;
+    }
+    /* goes to scope in front of next WF? of this channel */
+    status = LeCroy_Set_Wfsu(message->scopeID, message->channel, &wfsu);
+  }
+
+  dbScanLock(message->pRecord);
+
+  if (status == ERROR)
+    recGblSetSevr(lor, WRITE_ALARM, INVALID_ALARM); /* WRITE Alarm status */
+
+  ((lor->rset)->process)(message->pRecord);
+
+  dbScanUnlock(message->pRecord);
+}
+
 /***************************************************************************************/
 /********************************* Stringin RECORD *************************************/
 /***************************************************************************************/
@@ -1327,7 +3226,7 @@ static long readStringIn(struct stringinRecord* stringinr)
     struct vmeio *pvmeio;
     int status = OK;
     LeCroyID     ltid;
-    int          num;
+    SCOPE*            ps;
 
     /* stringin must be a VME_IO */
     switch (stringinr->inp.type) {
@@ -1341,15 +3240,15 @@ static long readStringIn(struct stringinRecord* stringinr)
     }
 
     /* Need IP for Scope - this comes from combination of card # and signal */
-    num = pvmeio->card;
-    ltid = scopeID[num];
+    ps = dpvt->ps;
+    ltid = (ps != NULL) ? ps->scopeID : NULL;
     if (ltid == 0){
       recGblRecordError(S_db_badField,(void *)stringinr,
 			"devStringInLT364 (readStringIn) Scope not connected?");
       return(S_db_badField);
     }
-    if (SCOPE_STATUS[num] == ERROR)
-      return SCOPE_STATUS[num];
+    if (ps->status == ERROR)
+      return ps->status;
 
     stringinr->pact = TRUE;
 
@@ -1387,7 +3286,7 @@ static long readStringIn(struct stringinRecord* stringinr)
     /* no records need to be handled asynchronously */
     if (message.cmd == ERROR){
       message.pRecord = (struct dbCommon*) stringinr;
-      if( epicsMessageQueueTrySend( msgQID[num], (void *)&message, sizeof(message)) == ERROR){
+      if( strandPost( &ps->strand, &message) == ERROR){
 	recGblSetSevr(stringinr, READ_ALARM, INVALID_ALARM); /* READ Alarm status */
 	stringinr->pact = FALSE;
 	return ERROR;
@@ -1480,17 +3379,32 @@ static void handleStringIn(TASK_DATA* message)
 static const iocshArg init_LT364Arg0 = { "num",iocshArgInt };
 /* static const iocshArg init_LT364Arg1 = { "ipaddr",iocshArgInt }; */
 static const iocshArg init_LT364Arg1 = { "ipaddr",iocshArgString };
-static const iocshArg * const init_LT364Args[2] = {
+static const iocshArg init_LT364Arg2 = { "format",iocshArgInt };
+static const iocshArg * const init_LT364Args[3] = {
        &init_LT364Arg0,
-       &init_LT364Arg1};
-static const iocshFuncDef init_LT364FuncDef = {"init_LT364",2,init_LT364Args};
+       &init_LT364Arg1,
+       &init_LT364Arg2};
+static const iocshFuncDef init_LT364FuncDef = {"init_LT364",3,init_LT364Args};
 static void init_LT364CallFunc(const iocshArgBuf *args)
 {
 /*    init_LT364(args[0].ival,args[1].ival); */
-    init_LT364(args[0].ival,args[1].sval);
+    init_LT364(args[0].ival,args[1].sval,args[2].ival);
+}
+
+static const iocshArg LeCroy_Conv_BenchArg0 = { "pts",iocshArgInt };
+static const iocshArg LeCroy_Conv_BenchArg1 = { "loops",iocshArgInt };
+static const iocshArg * const LeCroy_Conv_BenchArgs[2] = {
+       &LeCroy_Conv_BenchArg0,
+       &LeCroy_Conv_BenchArg1};
+static const iocshFuncDef LeCroy_Conv_BenchFuncDef = {"LeCroy_Conv_Bench",2,LeCroy_Conv_BenchArgs};
+static void LeCroy_Conv_BenchCallFunc(const iocshArgBuf *args)
+{
+    LeCroy_Conv_Bench(args[0].ival,args[1].ival);
 }
 void LeCroy_ENETRegister(void)
 {
    iocshRegister(&init_LT364FuncDef, init_LT364CallFunc);
+   iocshRegister(&LeCroy_Conv_BenchFuncDef, LeCroy_Conv_BenchCallFunc);
 }
 epicsExportRegistrar(LeCroy_ENETRegister);
+epicsExportAddress(int, lecroyPoolThreads);
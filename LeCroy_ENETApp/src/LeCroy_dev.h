@@ -9,18 +9,21 @@ extern "C" {
 
 #include <epicsThread.h>
 #include <epicsMessageQueue.h>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+#include <epicsTimer.h>
+#include <epicsEvent.h>
+#include <ellLib.h>
 
 /* Task Definitions */
 #define MAX_MSGS 50 /* At the time of development there are 37
 		       records.  set to 50 for worst case scenario of
 		       all records being processed at the same time */
 #define MAX_CHANNELS 4
-#define MAX_SCOPES 20
-static int SCOPE_STATUS[MAX_SCOPES];
 #define eventTaskPriority epicsThreadPriorityHigh
 
-static LeCroyID scopeID[MAX_SCOPES]; 
-static epicsMessageQueueId msgQID[MAX_SCOPES];
+struct SCOPE;
+
 /* define structure to be passed to task for performing asynchronous
    functions */
 typedef struct {
@@ -32,11 +35,192 @@ typedef struct {
 } TASK_DATA;
 #define MAX_MSG_LENGTH sizeof(TASK_DATA)
 
+/* scopes have no threads of their own. Messages of a scope queue up in
+   its strand, and one tScopePool worker at a time runs them in order, so
+   commands never overlap on the link of a scope while other scopes run
+   on other workers. Workers follow cores, not scopes, see
+   lecroyPoolThreads. A strand is on poolList at most once.
+   Scope strand has two lanes: setpoints, readbacks and timers go in qid,
+   waveform reads in bulk, and a worker only takes from bulk when qid is
+   empty. Acquire record reads channel by channel and runs what came in
+   qid meanwhile, so a setpoint waits for one channel, not for all four */
+typedef struct {
+  ELLNODE node;              /* in poolList */
+  epicsMessageQueueId qid;   /* messages of this strand, control lane of scope strand */
+  epicsMessageQueueId bulk;  /* waveform reads, NULL if strand has one lane */
+  int scheduled;             /* on poolList or running, under strandLock */
+  struct SCOPE* ps;
+  void (*run)(struct SCOPE* ps, TASK_DATA* message);
+} STRAND;
+#define POOL_THREADS_PER_CPU 2 /* workers mostly wait for scopes, not for cores */
+#define POOL_MIN_THREADS 4
+#define STRAND_BATCH 8         /* messages in a row, then other strands get the worker */
+static ELLLIST poolList;     /* strands waiting for a worker */
+static epicsEventId poolEvent;
+static epicsMutexId strandLock; /* protects poolList, and scheduled and pending flags */
+static int linkRecovers;      /* workers in LeCroy_Recover_Link, under strandLock */
+static int linkRecoverMax;    /* poolThreads / LINK_RECOVER_SHARE, at least 1 */
+
+/* two stages for waveform records not on I/O Intr: scope strand receives
+   samples into the record's raw buffer, then decode strand converts them
+   and processes the record, while scope strand receives the next one.
+   A record is busy until it is processed, so nobody writes its buffer
+   meanwhile, and raw buffers are what records have anyway. See decode
+   in SCOPE */
+
+/* periodic work of a scope runs in its strand, timers only post it there.
+   A timer doesn't post again while its last message still waits */
+typedef struct {
+  epicsTimerId timer;
+  struct SCOPE* ps;
+  int cmd;                   /* LT_TIMER_STATUS ... */
+  double period;             /* seconds */
+  int pending;               /* message in strand, under strandLock */
+} SCOPE_TIMER;
+#define SCOPE_TIMERS 2
+static epicsTimerQueueId timerQueue; /* shared by all scopes */
+#define LINK_CHECK_PERIOD 30.0 /* seconds, link down is recovered in scope strand */
+#define LINK_CHECK_TIMEOUT 6   /* seconds to connect */
+/* connect blocks a worker up to LINK_CHECK_TIMEOUT, so with many scopes
+   away only one in LINK_RECOVER_SHARE workers connects at a time, others
+   try again after LINK_CHECK_TIMEOUT. See linkRecovers */
+#define LINK_RECOVER_SHARE 4
+
+/* status poll for bi/mbbi/ai records with SCAN=I/O Intr, one per scope.
+   Scope strand reads everything with one LeCroy_Get_Status between
+   messages, then those records take their values from scopeStatus */
+#define STATUS_POLL_PERIOD 0.5 /* seconds */
+
+/* service request of each new acquisition processes acquire record with
+   SCAN=I/O Intr. One tScopeSrq thread selects on sockets of all scopes
+   with such a record, see LeCroy_Get_SrqFd, and posts LT_SRQ to the strand
+   of a scope whose socket is readable, which takes it with LeCroy_Wait_Srq.
+   While LT_SRQ waits in strand its socket is left out, handleSrq wakes
+   the thread with srqWakeSock when it is done */
+#define SRQ_WATCH_PERIOD 1.0 /* seconds, picks up link and SRQ enable changes */
+
+/* one acquisition for CH1~CH4 waveform records with SCAN=I/O Intr.
+   The acquire record reads channel by channel into these buffers, then
+   each channel's records convert from there. If their trigger times
+   differ, a trigger came in between and all of them are read again with
+   one LeCroy_Read_Multi, a channel still not matching goes to alarm. Next
+   acquisition goes into back buffers outside of acqLock, so records keep
+   converting the last one meanwhile, two buffers per channel at most */
+typedef struct {
+  IOSCANPVT scan;            /* waveform records of this channel */
+  void* buffer;              /* aligned raw samples, from LeCroy_Malloc_Raw */
+  void* back;                /* next acquisition goes here, then it swaps with buffer */
+  int bufSize;               /* biggest NELM of those records, for both */
+  int users;                 /* records on I/O Intr, not read if 0 */
+  int status;                /* OK if channel came with last acquisition */
+  LECROY_WFINFO info;
+  int lastStatus;            /* OK if last read of any record was good */
+  LECROY_WFINFO lastInfo;    /* for gain/offset records not on I/O Intr */
+  IOSCANPVT statScan;        /* min, max, mean, rms, area and peak records */
+  int statUsers;             /* those records, statistics are only worked out if not 0 */
+  int statStatus;            /* OK if last waveform record of channel gave them */
+  LECROY_WFSTAT stat;        /* from the same pass that converted it */
+  LECROY_WFINFO statInfo;    /* of that waveform, for trigger time */
+} ACQ_CHANNEL;
+
+/* sequence mode, one per channel. A waveform record with parm "seq" reads
+   all segments with LeCroy_Read_Seg, then "seqtime" and "seqoffset"
+   records with SCAN=I/O Intr take TRIGTIME_ARRAY of that read from here.
+   Like acqChannel, it arrives in back without acqLock and is swapped in */
+typedef struct {
+  IOSCANPVT scan;            /* seqtime and seqoffset records of this channel */
+  LECROY_SEGTIME* segtime;   /* TRIGTIME_ARRAY of last read */
+  LECROY_SEGTIME* back;      /* next one arrives here, under backLock */
+  int maxseg;                /* biggest NELM of those records */
+  int status;                /* OK if last read was good */
+  LECROY_WFINFO info;
+} SEQ_CHANNEL;
+
+/* WAVE_ARRAY_2 of a channel, like minimum of extrema or imaginary part of
+   FFT math. With a waveform record with parm "array2" on channel, the
+   waveform record of channel reads both arrays with LeCroy_Read_Arrays,
+   then "array2" records with SCAN=I/O Intr take second one from here.
+   Like acqChannel, it arrives in back without acqLock and is swapped in */
+typedef struct {
+  IOSCANPVT scan;            /* array2 records of this channel */
+  void* buffer;              /* aligned raw samples, from LeCroy_Malloc_Raw */
+  void* back;                /* next read arrives here, under backLock */
+  int bufSize;               /* biggest NELM of those records */
+  int users;                 /* array2 records, channel reads WAVE_ARRAY_2 if not 0 */
+  int status;                /* OK if last read was good */
+  LECROY_WFINFO info;        /* of last read, points is valid points of WAVE_ARRAY_2 */
+} ARR2_CHANNEL;
+
+/* gated integrals of CH1~CH4, up to MAX_ROIS windows of a channel, each
+   less baseline, mean volts of its own window like pre-trigger points, if
+   there is one. Worked out right after samples are read, ao and bo records
+   change windows any time, next read picks them up */
+#define MAX_ROIS 4
+typedef struct {
+  IOSCANPVT scan;            /* roi records of this channel */
+  int users;                 /* those records, nothing worked out if 0 */
+  int seconds;               /* windows are seconds from trigger, else points */
+  double basestart;          /* baseline window, none if stop isn't after start */
+  double basestop;
+  double start[MAX_ROIS];    /* window of each ROI, from start up to stop */
+  double stop[MAX_ROIS];
+  int baseStatus;            /* OK if last read gave baseline */
+  double baseline;           /* volts */
+  int status[MAX_ROIS];      /* OK if last read gave integral */
+  double integral[MAX_ROIS]; /* volt seconds */
+  LECROY_WFINFO info;        /* of last read, for trigger time */
+} ROI_CHANNEL;
+
+/* records with TSE=-2 carry trigger time of the acquisition they come
+   from, see LECROY_WFINFO trgtime. Older base doesn't name it */
+#ifndef epicsTimeEventDeviceTime
+#define epicsTimeEventDeviceTime -2
+#endif
+
+/* everything of one scope, init_LT364 allocates it. Records look theirs
+   up by card of VME_IO link once in init_record and keep it in dpvt */
+typedef struct SCOPE {
+  int num;                   /* card */
+  LeCroyID scopeID;
+  int status;                /* ERROR if init_LT364 failed */
+  STRAND strand;             /* records and timers, all that uses the link */
+  STRAND decode;             /* second stage of waveform records */
+  SCOPE_TIMER timer[SCOPE_TIMERS];
+  IOSCANPVT statusScan;
+  epicsMutexId statusLock;   /* protects the three below */
+  LECROY_STATUS scopeStatus;
+  int statusValid;           /* last poll succeeded */
+  int statusUsers;           /* records on I/O Intr, no poll if 0 */
+  LECROY_STATS scopeStats;   /* traffic counters, every poll */
+  IOSCANPVT srqScan;
+  int srqUsers;              /* acquire records on I/O Intr, no look if 0 */
+  int srqPending;            /* LT_SRQ in strand, under strandLock */
+  int srqLost;               /* with srqPending, LT_SRQ didn't fit in control lane,
+				strand posts it after its next message */
+  int wfCheck;               /* with wfcheckS on, waveforms are only transferred when
+				scope has acquired again since last read, see LeCroy_Read_Multi */
+  epicsMutexId acqLock;      /* protects acqChannel, seqChannel, arr2Channel and roiChannel */
+  epicsMutexId backLock;     /* held while samples are read into back buffers, take before acqLock */
+  ACQ_CHANNEL acqChannel[MAX_CHANNELS];
+  SEQ_CHANNEL seqChannel[MAX_CHANNELS];
+  ARR2_CHANNEL arr2Channel[TOTALCHNLS];
+  ROI_CHANNEL roiChannel[MAX_CHANNELS];
+} SCOPE;
+
+/* by card, as many slots as biggest card so far, no limit on scopes */
+static SCOPE** scopeList;
+static int scopeSlots;
+
 typedef struct {
   int deviceId;              /* enumerated type defining name of
 				device */
-  float* buffer;             /* array to store waveform data */
-  int bufSize;               /* buffer size of the waveform */
+  SCOPE* ps;                 /* scope of card in link, NULL if not initialized */
+  void* buffer;              /* aligned raw samples, from LeCroy_Malloc_Raw */
+  int bufSize;               /* buffer size of the waveform in points */
+  int index;                 /* ROI of roi records, from 0 */
+  LECROY_WFINFO info;        /* last read of waveform record, for wfcheckS */
+  int points;                /* what scope strand read for decode strand, ERROR if it failed */
+  int same;                  /* TRUE if scope had nothing new for it */
 } DPVT_DATA;
 
 /* define parameter indicator flags */
@@ -65,15 +249,94 @@ typedef enum {
   LT_STRINGIN_TRGTIME,
   LT_MBBI_LINKSTATUS=500, /* set to 500 to avoid conflict with types
 			     defined in driver */
-  LT_BO_RECOVER
+  LT_BO_RECOVER,
+  LT_BO_ACQUIRE,
+  LT_AI_GAIN,
+  LT_AI_OFFSET,
+  LT_MBBO_FORMAT,
+  LT_AI_T0,
+  LT_AI_DT,
+  LT_LO_SPARSING,
+  LT_LO_NPOINTS,
+  LT_LO_FIRSTPNT,
+  LT_BO_WFCHECK,
+  LT_AI_WFREAD,
+  LT_AI_WFSKIP,
+  LT_AI_WFSKIPRATIO,
+  LT_BO_SRQ,
+  LT_AO_TRGOFFSET,
+  LT_WF_SEQ,
+  LT_WF_SEQTIME,
+  LT_WF_SEQOFFSET,
+  LT_WF_ARRAY2,
+  LT_WF_TIME,
+  LT_AI_MIN,
+  LT_AI_MAX,
+  LT_AI_MEAN,
+  LT_AI_RMS,
+  LT_AI_AREA,
+  LT_AI_PEAK,
+  LT_AI_ROI,
+  LT_AI_ROIBASE,
+  LT_AO_ROISTART,
+  LT_AO_ROISTOP,
+  LT_AO_BASESTART,
+  LT_AO_BASESTOP,
+  LT_BO_ROIUNIT,
+  LT_TIMER_STATUS,           /* posted by scopeTimer, no record */
+  LT_TIMER_LINK,
+  LT_SRQ                     /* posted by tScopeSrq, no record */
 } LTTYPE;
 
+/* ai records that take their value from LECROY_WFINFO of a channel */
+#define WFINFO_AI(id) ((id) == LT_AI_GAIN || (id) == LT_AI_OFFSET || (id) == LT_AI_T0 || (id) == LT_AI_DT)
+/* ai records that take their value from LECROY_WFSTAT of a channel */
+#define WFSTAT_AI(id) ((id) >= LT_AI_MIN && (id) <= LT_AI_PEAK)
+/* ai records that take their value from ROI_CHANNEL */
+#define ROI_AI(id) ((id) == LT_AI_ROI || (id) == LT_AI_ROIBASE)
+/* ao records that set windows of ROI_CHANNEL */
+#define ROI_AO(id) ((id) >= LT_AO_ROISTART && (id) <= LT_AO_BASESTOP)
+/* ai records that take their value from scopeStats */
+#define STATS_AI(id) ((id) == LT_AI_WFREAD || (id) == LT_AI_WFSKIP || (id) == LT_AI_WFSKIPRATIO)
+
+static long reportLT364(int level);
+static SCOPE* scopeOf(int num);
 static long initRecord();
-static void readLTHelper( void *parm);
+static void poolLTHelper( void *parm);
+static int strandPost(STRAND* pstrand, TASK_DATA* message);
+static int bulkMsg(int cmd);
+static void strandYield(SCOPE* ps);
+static void scopeTimerExpire(void *parm);
+static void handleMsg(SCOPE* ps, TASK_DATA* message);
+static void handleTimer(SCOPE* ps, TASK_DATA* message);
+static void srqWatch(void *parm);
+static void srqPost(SCOPE* ps);
+static void srqWake(void);
+static void handleSrq(SCOPE* ps);
+static void handleRecord(TASK_DATA* message);
+static void pollStatus(SCOPE* ps);
+static long statusIoinitInfo(int cmd, struct dbCommon* prec, struct link* plink, IOSCANPVT* iopvt);
+static int getStatus(SCOPE* ps, LECROY_STATUS* pstatus);
 static void handleWf(TASK_DATA* message);
+static void decodeMsg(SCOPE* ps, TASK_DATA* message);
+static void decodeWf(TASK_DATA* message);
+static void handleSeq(TASK_DATA* message);
+static void storeSeqTime(waveformRecord* pwf, SCOPE* ps, int ch);
+static void storeArray2(waveformRecord* pwf, SCOPE* ps, int ch);
+static void storeTime(waveformRecord* pwf, SCOPE* ps, int ch);
+static int storeWf(waveformRecord* pwf, const LECROY_WFINFO* pinfo, const void* praw, int pts);
+static void storeStat(waveformRecord* pwf, int status, const LECROY_WFINFO* pinfo, const LECROY_WFSTAT* pstat);
+static void statUser(aiRecord* air);
+static int roiIndex(const char* parm);
+static void roiUser(aiRecord* air);
+static void integrate(SCOPE* ps, int ch, int status, const LECROY_WFINFO* pinfo, const void* praw);
+static void trgTime(struct dbCommon* prec, const LECROY_WFINFO* pinfo);
+static long wfIoinitInfo(int cmd, waveformRecord* pwf, IOSCANPVT* iopvt);
+static void handleAcquire(TASK_DATA* message);
 static long readWf();
 static long initBo();
 static long writeBo();
+static long boIoinitInfo(int cmd, boRecord* bor, IOSCANPVT* iopvt);
 static void handleEnableDisable(TASK_DATA* message);
 static void handleBo(TASK_DATA* message);
 static long initBi();
@@ -94,6 +357,9 @@ static void handleAi(TASK_DATA* message);
 static long initAo();
 static long writeAo();
 static void handleAo(TASK_DATA* message);
+static long initLo();
+static long writeLo();
+static void handleLo(TASK_DATA* message);
 static long initStringIn();
 static long readStringIn();
 static void handleStringIn(TASK_DATA* message);
@@ -108,14 +374,15 @@ typedef struct {
 	DEVSUPFUN	special_linconv;
 } VME_DEV_SUP_SET;
 
-VME_DEV_SUP_SET devWfLT364=   {6, NULL, NULL, initRecord, NULL, readWf, NULL};
-VME_DEV_SUP_SET devBoLT364=   {6, NULL, NULL, initBo, NULL, writeBo, NULL};
+VME_DEV_SUP_SET devWfLT364=   {6, reportLT364, NULL, initRecord, wfIoinitInfo, readWf, NULL};
+VME_DEV_SUP_SET devBoLT364=   {6, NULL, NULL, initBo, boIoinitInfo, writeBo, NULL};
 VME_DEV_SUP_SET devBiLT364=   {6, NULL, NULL, initBi, biIoinitInfo, readBi, NULL};
 VME_DEV_SUP_SET devMbbiLT364= {6, NULL, NULL, initMbbi, mbbiIoinitInfo, readMbbi, NULL};
 VME_DEV_SUP_SET devMbboLT364= {6, NULL, NULL, initMbbo, NULL, writeMbbo, NULL};
 VME_DEV_SUP_SET devAoLT364=   {6, NULL, NULL, initAo, NULL, writeAo, NULL};
 VME_DEV_SUP_SET devAiLT364=   {6, NULL, NULL, initAi, aiIoinitInfo, readAi, NULL};
 VME_DEV_SUP_SET devStringInLT364= {6, NULL, NULL, initStringIn, NULL, readStringIn, NULL};
+VME_DEV_SUP_SET devLoLT364=   {5, NULL, NULL, initLo, NULL, writeLo, NULL};
 #if     (EPICS_VERSION>=3 && EPICS_REVISION>=14) || EPICS_VERSION >=7
 epicsExportAddress(dset, devWfLT364);
 epicsExportAddress(dset, devBoLT364);
@@ -125,6 +392,7 @@ epicsExportAddress(dset, devMbboLT364);
 epicsExportAddress(dset, devAoLT364);
 epicsExportAddress(dset, devAiLT364);
 epicsExportAddress(dset, devStringInLT364);
+epicsExportAddress(dset, devLoLT364);
 #endif
 
 #ifdef __cplusplus
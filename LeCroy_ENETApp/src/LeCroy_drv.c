@@ -112,13 +112,15 @@
 /*                                                                                */
 /* Known Limitations:                                                             */
 /*    1. I don't think we need CLEAR in our cases.                                */
-/*    2. When we get SRQ, we just simply ignore it.                               */
+/*    2. SRQ is only used for new acquisition (INE 1;*SRE 1), its frames are      */
+/*       taken out of the stream wherever they come, see LeCroy_Take_Srq.         */
 /*    3. We don't do SERIALPOLL(OOB or in-bound) here.                            */
 /*                                                                                */
 /**********************************************************************************/
 
 /* includes */
 #include "LeCroy_drv.h"
+#include "LeCroy_conv.h"
 
 int     LECROY_DRV_DEBUG=0;
 
@@ -160,24 +162,34 @@ connectWithTimeout( int fd, struct sockaddr *addr, int size, struct timeval *tim
 
 
 
-/** this function will read all wanted data from socket with timeout(second) **/
-/** and set link status and return link status **/
-/** It is only called by LeCroy_Read_Response, so we don't do parameters check **/
-static int LeCroy_Read_Socket(LeCroyID lecroyid, char * pbuffer, int size, unsigned int toutsec)
+/** this function is called only when read-ahead buffer is empty, it blocks **/
+/** until something comes, then takes whatever kernel has in one readv. If  **/
+/** pbuffer isn't NULL, first size bytes go straight into it and the rest   **/
+/** lands in read-ahead buffer. Return bytes put into pbuffer, or ERROR     **/
+/** with link status set. It is only called by LeCroy_Read_Socket          **/
+static int LeCroy_Fill_Ring(LeCroyID lecroyid, char * pbuffer, int size, unsigned int toutsec)
 {
         fd_set          readFds;
 	struct timeval	timeout;
-	int		wantnumber;	/* how many bytes we are still wating for */
+	struct iovec	iov[2];
+	int		iovcnt=0;
 	int		gotnumber;	/* how many bytes we got this time */
 
-	if(lecroyid->linkstat!=LINK_OK) 
-		return lecroyid->linkstat;
-
-	wantnumber=size;
-	gotnumber=0;
+	lecroyid->rxpos=0;
+	lecroyid->rxlen=0;
 
-	while(wantnumber)
+	if(pbuffer)
 	{
+		iov[iovcnt].iov_base=pbuffer;
+		iov[iovcnt].iov_len=size;
+		iovcnt++;
+	}
+	iov[iovcnt].iov_base=lecroyid->prxring;
+	iov[iovcnt].iov_len=RXRING_SIZE;
+	iovcnt++;
+
+	if(toutsec!=lecroyid->rcvtoutsec)
+	{/* socket can't time out by itself with this timeout, so we select */
 		/* clear bits in read bit mask */
 		FD_ZERO (&readFds);
 		/* initialize bit mask */
@@ -193,103 +205,212 @@ static int LeCroy_Read_Socket(LeCroyID lecroyid, char * pbuffer, int size, unsig
 			close(lecroyid->sFd);
 			lecroyid->sFd= ERROR;
 			lecroyid->lasterr=LECROY_ERR_SELECT_SOCKET_TIMEOUT;
-			return lecroyid->linkstat;
+			return ERROR;
 		}
-		/* we don't need FD_ISSET, because we only check one sFd */
-		if ((gotnumber=read(lecroyid->sFd,pbuffer+size-wantnumber,wantnumber)) <= 0)
-		{/* error from read() */
-			lecroyid->linkstat=LINK_DOWN;
-			close(lecroyid->sFd);
-			lecroyid->sFd= ERROR;
-			lecroyid->lasterr=LECROY_ERR_READ_SOCKET_ERROR;
-			return lecroyid->linkstat;
+	}
+
+	/* we don't need FD_ISSET, because we only check one sFd */
+	do
+	{
+		gotnumber=readv(lecroyid->sFd,iov,iovcnt);
+	}while(gotnumber<0 && errno==EINTR);
+
+	if (gotnumber <= 0)
+	{/* error from readv(), EAGAIN means SO_RCVTIMEO expired */
+		lecroyid->lasterr=(gotnumber<0 && (errno==EAGAIN || errno==EWOULDBLOCK))?
+			LECROY_ERR_SELECT_SOCKET_TIMEOUT:LECROY_ERR_READ_SOCKET_ERROR;
+		lecroyid->linkstat=LINK_DOWN;
+		close(lecroyid->sFd);
+		lecroyid->sFd= ERROR;
+		return ERROR;
+	}
+	lecroyid->stats.rxbytes+=gotnumber;
+
+	if(pbuffer==NULL)
+	{
+		lecroyid->rxlen=gotnumber;
+		return 0;
+	}
+	if(gotnumber>size)
+	{/* read ahead of what caller wants */
+		lecroyid->rxlen=gotnumber-size;
+		return size;
+	}
+	return gotnumber;
+}
+
+/** this function will read all wanted data from socket with timeout(second) **/
+/** and set link status and return link status, if pbuffer is NULL, we just  **/
+/** throw size bytes away. Data comes from read-ahead buffer first, we only   **/
+/** go to socket when it is empty, so a short reply costs one read in total  **/
+/** It is only called by LeCroy_Read_Response, so we don't do parameters check **/
+static int LeCroy_Read_Socket(LeCroyID lecroyid, char * pbuffer, int size, unsigned int toutsec)
+{
+	int		wantnumber;	/* how many bytes we are still wating for */
+	int		gotnumber;	/* how many bytes we got this time */
+
+	if(lecroyid->linkstat!=LINK_OK) 
+		return lecroyid->linkstat;
+
+	wantnumber=size;
+
+	while(wantnumber)
+	{
+		if(lecroyid->rxlen>lecroyid->rxpos)
+		{/* still something in read-ahead buffer */
+			gotnumber=min(wantnumber,(int)(lecroyid->rxlen-lecroyid->rxpos));
+			if(pbuffer)
+				memcpy(pbuffer+size-wantnumber,lecroyid->prxring+lecroyid->rxpos,gotnumber);
+			lecroyid->rxpos+=gotnumber;
+		}
+		else
+		{/* small reads go through read-ahead buffer, big ones straight to caller */
+			if((gotnumber=LeCroy_Fill_Ring(lecroyid,
+				(pbuffer && wantnumber>=RXRING_BYPASS)?pbuffer+size-wantnumber:NULL,
+				wantnumber,toutsec))==ERROR)
+				return lecroyid->linkstat;
 		}
 		wantnumber=wantnumber-gotnumber;
 	}
 	return lecroyid->linkstat;
 }
 
-/** this function will send all data via socket **/
-/** and set link status and return link status  **/
-/** It is only called by LeCroy_Operate, so we don't do parameters check **/
-/** We only write couple bytes command, so we don't select to timeout    **/
-static int LeCroy_Write_Command(LeCroyID lecroyid, char * pCommand)
+/** this function will send all commands in pops via socket back-to-back, **/
+/** and set link status and return link status. Each command goes out with **/
+/** its own VICP sequence number, saved in pops[].seqnum, so responses can  **/
+/** be matched to it. Headers are built on stack, all of them go out with   **/
+/** commands in one writev, a short write just means we keep writing        **/
+/** It is only called by LeCroy_Operate_Batch and LeCroy_Write_Command,     **/
+/** so we don't do parameters check, nops is never more than MAX_BATCH_OPS  **/
+/** We only write couple bytes command, so we don't select to timeout       **/
+static int LeCroy_Write_Commands(LeCroyID lecroyid, LECROY_OP * pops, int nops)
 {
-	char	* pCMD;	/* buffer to send out command */
-	int	CMDLEN;
+	unsigned char	header[MAX_BATCH_OPS][COMM_HDR_SIZE];
+	struct iovec	iov[2*MAX_BATCH_OPS];
+	struct iovec	* piov=iov;
+	int		iovcnt=0;
+	unsigned int	cmdlen;
+	int		sent;
+	int		loop;
 	
 	if(lecroyid->linkstat!=LINK_OK) 
 		return lecroyid->linkstat;
 
-	/* buffer size should be command size + header size(8) and \0 */
-	pCMD=(char *)malloc(strlen(pCommand)+8+1);
+	for(loop=0;loop<nops;loop++)
+	{
+		cmdlen=strlen(pops[loop].pCmd);	/* don't send out \0 */
+
+		/* 1~255 for v1a, never 0, so scope knows we check sequence */
+		lecroyid->lastSeqNum=(lecroyid->lastSeqNum%COMM_HDR_SEQ_MAX)+1;
+		pops[loop].seqnum=lecroyid->lastSeqNum;
+
+		header[loop][0]=COMM_HDR_OPER_DATA|COMM_HDR_OPER_EOI;
+		header[loop][1]=COMM_HDR_VER_1;
+		header[loop][2]=pops[loop].seqnum;
+		header[loop][3]=0; /* only one frame will be send to scope for each command */
+		/* even you set CORD LO; don't affect header, it is always big-endian */
+		COMM_HDR_SET_SIZE(header[loop], cmdlen);
+
+		iov[iovcnt].iov_base=(char *)header[loop];
+		iov[iovcnt].iov_len=COMM_HDR_SIZE;
+		iovcnt++;
+		iov[iovcnt].iov_base=pops[loop].pCmd;
+		iov[iovcnt].iov_len=cmdlen;
+		iovcnt++;
+	}
 
-	pCMD[0]='\x81';
-	pCMD[1]='\x1';
-	pCMD[2]='\x0';
-	pCMD[3]='\x0'; /* only one frame will be send to scope */
+	while(iovcnt>0)
+	{
+		if((sent=writev(lecroyid->sFd, piov, iovcnt))<0 && errno==EINTR)
+			continue;	/* interrupted before anything went out */
 
-	/* if we don't call htonl,this is only good for BIG_ENDIAN platform */
-	/* on LITTLE_ENDIAN platform, you have to call LONGSWAP */
-	/* because even you set CORD LO; don't affect header */
-	*((long int *)(pCMD+4))=htonl(strlen(pCommand));
-	
-	strcpy(pCMD+8,pCommand);
-	
-	CMDLEN=strlen(pCommand)+8;	/* don't send out \0 */
-	
-	if(write(lecroyid->sFd, pCMD, CMDLEN)!=CMDLEN)
-	{/* error from write() */
-		lecroyid->linkstat=LINK_DOWN;
-		close(lecroyid->sFd);
-		lecroyid->sFd= ERROR;
-		lecroyid->lasterr=LECROY_ERR_WRITE_COMMAND_ERROR;
+		if(sent<=0)
+		{/* error from writev() */
+			lecroyid->linkstat=LINK_DOWN;
+			close(lecroyid->sFd);
+			lecroyid->sFd= ERROR;
+			lecroyid->lasterr=LECROY_ERR_WRITE_COMMAND_ERROR;
+			return lecroyid->linkstat;
+		}
+
+		/* short write, skip whatever already went out and send the rest */
+		while(iovcnt>0 && (unsigned int)sent>=piov->iov_len)
+		{
+			sent-=piov->iov_len;
+			piov++;
+			iovcnt--;
+		}
+		if(iovcnt>0)
+		{
+			piov->iov_base=(char *)piov->iov_base+sent;
+			piov->iov_len-=sent;
+		}
 	}
-	
-	free(pCMD);
 
 	return lecroyid->linkstat;
 }
 
-/** this function will read whole response from scope and set link status      **/
-/** and return link status, user has to call free(*ppbuf) after successfully   **/
-/** called this function, toutsec is in second and just for every socket read, **/
-/** not for whole this function, this function might do many times socker read **/
-/** It is only called by LeCroy_Operate, so we don't do parameters check       **/
-static int LeCroy_Read_Response(LeCroyID lecroyid, char ** ppbuf, int * psize, unsigned int toutsec)
+/** send one command, its sequence number is left in lecroyid->lastSeqNum **/
+/** It is only called by LeCroy_Read_Raw, so we don't do parameters check  **/
+static int LeCroy_Write_Command(LeCroyID lecroyid, char * pCommand)
 {
-	int		loop;		/*loop control*/
-	
-	unsigned char 	header[8];
-	
-	unsigned int	packetsize=0;	/* size of incoming packet */
-	
-	char		* polddata;
-	char		* pdata;
+	LECROY_OP	op;
 
-	unsigned int	olddatasize=0;	/* data size is real memory size minus one */
-	unsigned int	datasize=0;	/* data size is real memory size minus one */
-
-	if(lecroyid->linkstat!=LINK_OK) 
-		return lecroyid->linkstat;	/* not so necessary, but for saving time */
+	op.pCmd=pCommand;
+	return LeCroy_Write_Commands(lecroyid, &op, 1);
+}
 
-	bzero((char *)header,8);
+/** this function takes payload of SRQ block with header in header out of  **/
+/** stream, scope sends '1' when it asserts SRQ and '0' when it releases it **/
+/** Set link status and return link status                                 **/
+/** It is only called by LeCroy_Read_Header and LeCroy_Poll_Srq           **/
+static int LeCroy_Take_Srq(LeCroyID lecroyid, unsigned char * header, unsigned int toutsec)
+{
+	unsigned int	size=COMM_HDR_GET_SIZE(header);
+	char		state='0';
 
-	pdata=(char *)malloc(1); /* we keep the read back ends with '\0', so following function can use string tool */
-	pdata[0]='\0';
-	datasize=0;	/* not necessary here, but just for easy reading */
+	if(size>0 && LeCroy_Read_Socket(lecroyid, &state, 1, toutsec)!=LINK_OK)
+		return	lecroyid->linkstat;
+	if(size>1 && LeCroy_Read_Socket(lecroyid, NULL, size-1, toutsec)!=LINK_OK)
+		return	lecroyid->linkstat;
 
-	for(loop=0;loop<1000;loop++)	/* just for avoid dead loop, loop will end on 0x81 */
+	if(state=='1')
 	{
-		polddata=pdata;
-		olddatasize=datasize;
+		lecroyid->stats.srqs++;
+		lecroyid->srqtaken=TRUE;
+		epicsEventSignal(lecroyid->srqEvent);
+	}
+	return	lecroyid->linkstat;
+}
 
-		/*read head just like 0x80(0x81),1,0,0,4 bytes length*/
-		
-		if(LeCroy_Read_Socket(lecroyid, (char *)header, 8, toutsec)!=LINK_OK)
-		{
-			free(polddata);
+/** this function reads header of next VICP block belongs to response of    **/
+/** command seqnum, set link status and return link status. v1a scope echoes **/
+/** sequence number of command in its response, a block a little bit behind  **/
+/** is left over from an earlier query nobody read, we throw it away. A block **/
+/** ahead means response we wait for is lost, that is out of sync, we force  **/
+/** link down. v1 scope always answers 0, then we can't check, just take it. **/
+/** LeCroy's own VICP client has only one command outstanding and drops any  **/
+/** block not numbered like last command it sent, so it never tells if scope **/
+/** stamps a response with its command or with last command received. With  **/
+/** several commands outstanding only the first keeps us in sync, so if a    **/
+/** batch goes out of sequence LeCroy_Init sets nopipe and we send them one  **/
+/** at a time from then on, see LeCroy_Operate_Batch                         **/
+static int LeCroy_Read_Header(LeCroyID lecroyid, unsigned char * header, unsigned char seqnum, unsigned int toutsec)
+{
+	int		loop;		/* just for avoid dead loop on stale blocks */
+	unsigned int	behind;		/* how far this block is behind seqnum */
+
+	for(loop=0;loop<1000;loop++)
+	{
+		/*read head just like 0x80(0x81),1,seq,0,4 bytes length*/
+		if(LeCroy_Read_Socket(lecroyid, (char *)header, COMM_HDR_SIZE, toutsec)!=LINK_OK)
 			return	lecroyid->linkstat;
+
+		if(header[0]&COMM_HDR_OPER_SRQ)
+		{/* scope sends it whenever, even in the middle of a response */
+			if(LeCroy_Take_Srq(lecroyid, header, toutsec)!=LINK_OK)
+				return	lecroyid->linkstat;
+			continue;
 		}
 
 		if( (header[0]&0xFE)!=0x80||header[1]!=0x1)
@@ -298,34 +419,119 @@ static int LeCroy_Read_Response(LeCroyID lecroyid, char ** ppbuf, int * psize, u
 			close(lecroyid->sFd);
 			lecroyid->sFd= ERROR;
 			lecroyid->lasterr=LECROY_ERR_RESPONSE_PROTOCOL_ERR;
-			free(polddata);
 			return	lecroyid->linkstat;
 		}
-		
-		/* read header so we know the length of following block's length */
-		packetsize=ntohl(*((long int *)(header+4)));	/* convert 4 bytes to integer.it is length of block following */
 
-		if((pdata=(char *)malloc(olddatasize+packetsize+1))==NULL)
+		if(header[2]==0)
+		{/* v1 scope, no sequence number at all */
+			lecroyid->VICP_Revision=COMM_HDR_REV_0;
+			return	lecroyid->linkstat;
+		}
+
+		lecroyid->VICP_Revision=COMM_HDR_REV_A;
+		if(header[2]==seqnum)
+			return	lecroyid->linkstat;
+
+		/* sequence number wraps 255->1, so count distance modulo 255 */
+		behind=(seqnum+COMM_HDR_SEQ_MAX-header[2])%COMM_HDR_SEQ_MAX;
+		if(behind>COMM_HDR_SEQ_MAX/2)
 		{
 			lecroyid->linkstat=LINK_DOWN;
 			close(lecroyid->sFd);
 			lecroyid->sFd= ERROR;
-			lecroyid->lasterr=LECROY_ERR_RESPONSE_MALLOC_ERR;
-			free(polddata);
+			lecroyid->lasterr=LECROY_ERR_RESPONSE_OUT_OF_SEQ;
+			return	lecroyid->linkstat;
+		}
+
+		if(LECROY_DRV_DEBUG) printf("Scope[%s] drops stale block of command %d, waiting for %d\n", lecroyid->IPAddr, header[2], seqnum);
+		if(LeCroy_Read_Socket(lecroyid, NULL, COMM_HDR_GET_SIZE(header), toutsec)!=LINK_OK)
 			return	lecroyid->linkstat;
+	}
+
+	lecroyid->linkstat=LINK_DOWN;
+	close(lecroyid->sFd);
+	lecroyid->sFd= ERROR;
+	lecroyid->lasterr=LECROY_ERR_RESPONSE_DEADLOOP;
+	return	lecroyid->linkstat;
+}
+
+/** this function makes sure receive arena can hold at least size bytes   **/
+/** arena grows geometrically, so after first few big waveforms, steady   **/
+/** state acquisition never calls allocator again. Caller holds semLecroy **/
+static STATUS LeCroy_Grow_Rcvbuf(LeCroyID lecroyid, unsigned int size)
+{
+	char		* pnew;
+	unsigned int	newsize;
+
+	if(size<=lecroyid->rcvbufsize)
+		return OK;
+
+	newsize=(lecroyid->rcvbufsize>0)?lecroyid->rcvbufsize:RCVBUF_INIT_SIZE;
+	while(newsize<size)
+	{
+		if(newsize>(~0U)/2)
+		{/* can't double any more, just try what we need */
+			newsize=size;
+			break;
 		}
+		newsize*=2;
+	}
+
+	/* realloc keeps what we already got in this transaction */
+	if((pnew=(char *)realloc(lecroyid->prcvbuf,newsize))==NULL)
+		return ERROR;
+
+	lecroyid->prcvbuf=pnew;
+	lecroyid->rcvbufsize=newsize;
+	if(LECROY_DRV_DEBUG) printf("Receive arena of scope[%s] grows to %u bytes\n", lecroyid->IPAddr, newsize);
+	return OK;
+}
+
+/** this function will read whole response of command seqnum from scope into **/
+/** receive arena from offset on, and set link status and return link status, **/
+/** response is terminated with '\0' there, *psize doesn't count it. Arena    **/
+/** might move when it grows, so caller keeps offset instead of pointer. toutsec **/
+/** is in second and just for every socket read, not for whole this function,  **/
+/** this function might do many times socker read                              **/
+/** It is only called by LeCroy_Operate_Batch, so we don't do parameters check **/
+static int LeCroy_Read_Response(LeCroyID lecroyid, unsigned char seqnum, unsigned int offset, int * psize, unsigned int toutsec)
+{
+	int		loop;		/*loop control*/
+	
+	unsigned char 	header[COMM_HDR_SIZE];
+	
+	unsigned int	packetsize=0;	/* size of incoming packet */
 
-		bzero(pdata,olddatasize+packetsize+1);
-		memcpy(pdata,polddata,olddatasize);
-		free(polddata);
+	unsigned int	datasize=0;	/* data size is real memory size minus one */
+
+	if(lecroyid->linkstat!=LINK_OK) 
+		return lecroyid->linkstat;	/* not so necessary, but for saving time */
+
+	datasize=0;	/* not necessary here, but just for easy reading */
+
+	for(loop=0;loop<1000;loop++)	/* just for avoid dead loop, loop will end on 0x81 */
+	{
+		if(LeCroy_Read_Header(lecroyid, header, seqnum, toutsec)!=LINK_OK)
+			return	lecroyid->linkstat;
+		
+		/* read header so we know the length of following block's length */
+		packetsize=COMM_HDR_GET_SIZE(header);	/* convert 4 bytes to integer.it is length of block following */
 
-		if(LeCroy_Read_Socket(lecroyid, pdata+olddatasize, packetsize, toutsec)!=LINK_OK)
+		/* we keep the read back ends with '\0', so following function can use string tool */
+		if(LeCroy_Grow_Rcvbuf(lecroyid, offset+datasize+packetsize+1)!=OK)
 		{
-			free(pdata);
+			lecroyid->linkstat=LINK_DOWN;
+			close(lecroyid->sFd);
+			lecroyid->sFd= ERROR;
+			lecroyid->lasterr=LECROY_ERR_RESPONSE_MALLOC_ERR;
 			return	lecroyid->linkstat;
 		}
 
-		datasize=olddatasize+packetsize;
+		/* every block lands right behind previous one, so each byte is copied only once */
+		if(LeCroy_Read_Socket(lecroyid, lecroyid->prcvbuf+offset+datasize, packetsize, toutsec)!=LINK_OK)
+			return	lecroyid->linkstat;
+
+		datasize+=packetsize;
 		
 		if(header[0]==0x81)	break;
 	}
@@ -336,31 +542,153 @@ static int LeCroy_Read_Response(LeCroyID lecroyid, char ** ppbuf, int * psize, u
 		close(lecroyid->sFd);
 		lecroyid->sFd= ERROR;
 		lecroyid->lasterr=LECROY_ERR_RESPONSE_DEADLOOP;
-		free(pdata);
 		return	lecroyid->linkstat;
 	}
 
-	*ppbuf=pdata;
+	lecroyid->prcvbuf[offset+datasize]='\0';
 	*psize=datasize;
 	return	lecroyid->linkstat;
 }
-/** call all three functions above must be protected by semaphore **/
+/** Following three functions read a long response as a byte stream, ignoring  **/
+/** VICP block boundaries, so we can put each part of it right where it goes.  **/
+/** LeCroy_Begin_Stream must be called right after command is sent.            **/
+/** They are only called by LeCroy_Read_Raw, so we don't do parameters check   **/
+static void LeCroy_Begin_Stream(LeCroyID lecroyid)
+{
+	lecroyid->blkseq=lecroyid->lastSeqNum;
+	lecroyid->blkremain=0;
+	lecroyid->blkeoi=FALSE;
+}
 
-/** user has to call free(*pprdbk) after successfully called this function,     **/
-/** toutsec is in second and not for whole function, just for each socket read  **/
-/** in this function, this function might do many times socket read. If "query" **/
-/** is not TRUE, you can specify last three parameters to NULL,NULL,0           **/
-static STATUS LeCroy_Operate(LeCroyID lecroyid, char * pCmd, BOOL query, char ** pprdbk, int *prdbksize, unsigned int toutsec)
+/** read size bytes of response into pdst, or throw them away if pdst is NULL **/
+/** *pgot tells how many we really got, it is less than size only when the    **/
+/** response ends (EOI) earlier. Return link status                           **/
+static int LeCroy_Read_Stream(LeCroyID lecroyid, char * pdst, unsigned int size, unsigned int * pgot, unsigned int toutsec)
+{
+	unsigned char	header[COMM_HDR_SIZE];
+	unsigned int	chunk;
+	int		loop=0;		/* just for avoid dead loop on empty blocks */
+
+	*pgot=0;
+
+	while(size>0)
+	{
+		if(lecroyid->blkremain==0)
+		{/* current block is used up */
+			if(lecroyid->blkeoi)	break;	/* whole response is used up */
+			if(++loop>1000)
+			{
+				lecroyid->linkstat=LINK_DOWN;
+				close(lecroyid->sFd);
+				lecroyid->sFd= ERROR;
+				lecroyid->lasterr=LECROY_ERR_RESPONSE_DEADLOOP;
+				return	lecroyid->linkstat;
+			}
+
+			if(LeCroy_Read_Header(lecroyid, header, lecroyid->blkseq, toutsec)!=LINK_OK)
+				return	lecroyid->linkstat;
+
+			lecroyid->blkremain=COMM_HDR_GET_SIZE(header);
+			lecroyid->blkeoi=(header[0]==0x81);
+			continue;
+		}
+
+		loop=0;
+		chunk=min(size,lecroyid->blkremain);
+		/* straight into caller's buffer, or just skipped if pdst is NULL */
+		if(LeCroy_Read_Socket(lecroyid, pdst?pdst+*pgot:NULL, chunk, toutsec)!=LINK_OK)
+			return	lecroyid->linkstat;
+
+		lecroyid->blkremain-=chunk;
+		*pgot+=chunk;
+		size-=chunk;
+	}
+
+	return	lecroyid->linkstat;
+}
+
+/** throw away whatever is left of the response, so link stays in sync **/
+static int LeCroy_Drain_Stream(LeCroyID lecroyid, unsigned int toutsec)
+{
+	unsigned int	got;
+
+	return	LeCroy_Read_Stream(lecroyid, NULL, ~0U, &got, toutsec);
+}
+
+/** this function takes whatever came while nobody waits for a response, **/
+/** that is SRQ blocks, or blocks of a query nobody read, thrown away.     **/
+/** It doesn't block when nothing is there. Set and return link status    **/
+/** It is only called by LeCroy_Wait_Srq                                   **/
+static int LeCroy_Poll_Srq(LeCroyID lecroyid)
+{
+	unsigned char	header[COMM_HDR_SIZE];
+	fd_set		readFds;
+	struct timeval	timeout;
+
+	while(lecroyid->linkstat==LINK_OK)
+	{
+		if(lecroyid->rxlen<=lecroyid->rxpos)
+		{/* read-ahead buffer is empty, see if socket has something */
+			FD_ZERO (&readFds);
+			FD_SET (lecroyid->sFd, &readFds);
+			timeout.tv_sec=0;
+			timeout.tv_usec=0;
+			if(select (lecroyid->sFd+1, &readFds, NULL, NULL, &timeout) <= 0)
+				break;
+		}
+
+		/* scope sends a block in one go, so rest of it won't take long */
+		if(LeCroy_Read_Socket(lecroyid, (char *)header, COMM_HDR_SIZE, READ_TIMEOUT)!=LINK_OK)
+			break;
+
+		if(header[0]&COMM_HDR_OPER_SRQ)
+			LeCroy_Take_Srq(lecroyid, header, READ_TIMEOUT);
+		else if( (header[0]&0xFE)!=0x80||header[1]!=0x1)
+		{
+			lecroyid->linkstat=LINK_DOWN;
+			close(lecroyid->sFd);
+			lecroyid->sFd= ERROR;
+			lecroyid->lasterr=LECROY_ERR_RESPONSE_PROTOCOL_ERR;
+		}
+		else
+		{
+			if(LECROY_DRV_DEBUG) printf("Scope[%s] drops stale block of command %d\n", lecroyid->IPAddr, header[2]);
+			LeCroy_Read_Socket(lecroyid, NULL, COMM_HDR_GET_SIZE(header), READ_TIMEOUT);
+		}
+	}
+	return	lecroyid->linkstat;
+}
+
+/** call all functions above must be protected by semaphore **/
+
+/** This function writes all commands in pops back-to-back, then collects   **/
+/** responses of queries in order, so whole batch costs one network round   **/
+/** trip instead of one for each query. Each response is matched to its     **/
+/** query by VICP sequence number. If scope has nopipe, each command waits  **/
+/** for response of the one before. pops[].prdbk points into receive arena, **/
+/** don't free it, and keep holding semLecroy while using it, it is         **/
+/** overwritten by next transaction. pops[].done tells how far we got when  **/
+/** it returns ERROR. toutsec is in second and not for whole function, just **/
+/** for each socket read in this function                                   **/
+static STATUS LeCroy_Operate_Batch(LeCroyID lecroyid, LECROY_OP * pops, int nops, unsigned int toutsec)
 {
+	unsigned int	offset[MAX_BATCH_OPS];	/* where each response starts in arena */
+	unsigned int	used=0;			/* arena used by responses so far */
+	int		loop, first, step;
+
 	/* fail to LeCroy_Open, it's not necessary,because we never call this function standalone */ 
 	if(lecroyid==NULL) return ERROR;
 	/* Parameter check */
-	if( pCmd == NULL || strlen(pCmd) == 0 || (query && (pprdbk == NULL || prdbksize == NULL)) )
-	{/* This is a static function, it is only called internally, so it must not have parameter issue */
-	 /* Once illegal parameter appeared, that is a program issue, we got to fix it */
-	 /* We should simply return ERROR. If we do that, we might fail to do some important thing that user wants, */
-	 /* but leave linkstat LINK_OK. So we would suspend task, and force to fix bug */
-		printf("Illegal parameter when call LeCroy_Operate for scope[%s]!\n", lecroyid->IPAddr);
+	for(loop=0;pops!=NULL && loop<nops;loop++)
+	{
+		if(pops[loop].pCmd==NULL || pops[loop].pCmd[0]=='\0') break;
+		pops[loop].done=FALSE;
+		pops[loop].prdbk=NULL;
+		pops[loop].rdbksize=0;
+	}
+	if( pops == NULL || nops <= 0 || nops > MAX_BATCH_OPS || loop < nops )
+	{/* same as LeCroy_Operate, this is a program issue, we suspend task to force to fix bug */
+		printf("Illegal parameter when call LeCroy_Operate_Batch for scope[%s]!\n", lecroyid->IPAddr);
                 epicsThreadSuspendSelf();
 		return ERROR;
 	}
@@ -373,23 +701,71 @@ static STATUS LeCroy_Operate(LeCroyID lecroyid, char * pCmd, BOOL query, char **
 		return	ERROR;
 	}
 
-	if(LeCroy_Write_Command(lecroyid, pCmd)!=LINK_OK)
+	/* scope answers queries in the order we sent them */
+	step=lecroyid->nopipe?1:nops;
+	for(first=0,loop=0;first<nops && loop==first;first+=step)
 	{
-		epicsMutexUnlock(lecroyid->semLecroy);
-		return	ERROR;
+		if(LeCroy_Write_Commands(lecroyid, pops+first, (nops-first<step)?(nops-first):step)!=LINK_OK)
+			break;
+		for(loop=first;loop<nops && loop<first+step;loop++)
+		{
+			if(pops[loop].query)
+			{
+				offset[loop]=used;
+				if(LeCroy_Read_Response(lecroyid, pops[loop].seqnum, used, &(pops[loop].rdbksize), toutsec)!=LINK_OK)
+					break;
+				used+=pops[loop].rdbksize+1;	/* keep '\0' */
+			}
+			pops[loop].done=TRUE;
+		}
 	}
 
-	if(query)
+	/* arena might have moved while responses came, so pointers are set at last */
+	for(loop=0;loop<nops && pops[loop].done;loop++)
 	{
-		if(LeCroy_Read_Response(lecroyid, pprdbk, prdbksize,toutsec)!=LINK_OK)
-		{
-			epicsMutexUnlock(lecroyid->semLecroy);
-			return	ERROR;
-		}
+		if(pops[loop].query)
+			pops[loop].prdbk=lecroyid->prcvbuf+offset[loop];
 	}
 							
 	epicsMutexUnlock(lecroyid->semLecroy);
 
+	return (loop==nops)?OK:ERROR;
+}
+
+/** *pprdbk points into receive arena, don't free it, and keep holding         **/
+/** semLecroy while using it, it is overwritten by next transaction. toutsec   **/
+/** is in second and not for whole function, just for each socket read in this **/
+/** function, this function might do many times socket read. If "query" is not **/
+/** TRUE, you can specify last three parameters to NULL,NULL,0                  **/
+static STATUS LeCroy_Operate(LeCroyID lecroyid, char * pCmd, BOOL query, char ** pprdbk, int *prdbksize, unsigned int toutsec)
+{
+	LECROY_OP	op;
+
+	/* fail to LeCroy_Open, it's not necessary,because we never call this function standalone */ 
+	if(lecroyid==NULL) return ERROR;
+	/* Parameter check */
+	if( pCmd == NULL || pCmd[0] == '\0' || (query && (pprdbk == NULL || prdbksize == NULL)) )
+	{/* This is a static function, it is only called internally, so it must not have parameter issue */
+	 /* Once illegal parameter appeared, that is a program issue, we got to fix it */
+	 /* We should simply return ERROR. If we do that, we might fail to do some important thing that user wants, */
+	 /* but leave linkstat LINK_OK. So we would suspend task, and force to fix bug */
+		printf("Illegal parameter when call LeCroy_Operate for scope[%s]!\n", lecroyid->IPAddr);
+                epicsThreadSuspendSelf();
+		return ERROR;
+	}
+
+	/* just a batch of one */
+	op.pCmd=pCmd;
+	op.query=query;
+	if(LeCroy_Operate_Batch(lecroyid, &op, 1, toutsec)==ERROR)
+		return	ERROR;
+
+	if(query)
+	{
+		*pprdbk=op.prdbk;
+		*prdbksize=op.rdbksize;
+	}
+
 	return OK;
 }
 
@@ -403,8 +779,10 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 	int			optval;		/* for setsockopt */
 	struct	timeval		timeout;	/* for connectWithTimeout */
 
-	char			* prdbk;	/* to read back template and IDN and channel status */
-	int			rdbksize;	/* to read back template and IDN and channel status */
+	LECROY_OP		initops[4];	/* init, read back template and IDN and channel status */
+	char			initcmd[MAX_CMD_STRING_SIZE];	/* CFMT of this scope and INIT_STRING */
+	char			* prdbk;	/* channel status */
+	char			* pModel;	/* model in IDN */
 
 	int			loop;		/* check all channels' status */
 	char			* pLast = NULL;	/* for strtok_r */
@@ -434,8 +812,18 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 	optval=1;
 	setsockopt(lecroyid->sFd, IPPROTO_TCP, TCP_NODELAY, (char *)&optval, sizeof (optval));
 	/* enlarge receive buffer */
-	optval=8192;
+	optval=SOCK_RCVBUF_SIZE;
 	setsockopt(lecroyid->sFd, SOL_SOCKET, SO_RCVBUF, (char *)&optval, sizeof (optval));
+	/* let read time out by itself, so we don't need select before every read */
+	timeout.tv_sec=READ_TIMEOUT;
+	timeout.tv_usec=0;
+	if(setsockopt(lecroyid->sFd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof (timeout))==0)
+		lecroyid->rcvtoutsec=READ_TIMEOUT;
+	else
+		lecroyid->rcvtoutsec=0;
+	/* anything left in read-ahead buffer belongs to previous connection */
+	lecroyid->rxpos=0;
+	lecroyid->rxlen=0;
 
 	/* bind not required - port number is dynamic */
 
@@ -465,32 +853,53 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 		lecroyid->linkstat=LINK_OK;
 	/* reach here, finished setting up tcp connection to LeCroy scope */
 
-	/* initialize scope communication mode */
-	if(LeCroy_Operate(lecroyid,INIT_STRING,FALSE,NULL,NULL,0)==ERROR)
-	{
-		/*lecroyid->linkstat=LINK_DOWN;*/	/* LeCroy_Operate already set it */
-		lecroyid->lasterr=LECROY_ERR_INIT_INITSCOPE_ERR;
-		/*close (lecroyid->sFd);*/ /* LeCroy_Operate already closed it, it's dangerous to close twice */
-		/*lecroyid->sFd= ERROR;*/
-		if(LECROY_DRV_DEBUG) printf("Fail to init scope[%s]!\n", lecroyid->IPAddr);
-		return ERROR;
+	/* initialize scope communication mode, read back template, model information and */
+	/* all channels' status, all of them go out together and cost one round trip      */
+	sprintf(initcmd, "%s;%s", (lecroyid->format==LECROY_FMT_WORD)?CFMT_WORD_STRING:CFMT_BYTE_STRING, INIT_STRING);
+	if(lecroyid->srqenable)
+	{/* an acquisition scope made while link was down asks for service right away */
+		strcat(initcmd, ";");
+		strcat(initcmd, SRQ_ON_STRING);
 	}
-
-	/* readback template */
-	if(LeCroy_Operate(lecroyid,TMPL_STRING,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
+	initops[0].pCmd=initcmd;
+	initops[0].query=FALSE;
+	initops[1].pCmd=TMPL_STRING;
+	initops[1].query=TRUE;
+	initops[2].pCmd=IDN_STRING;
+	initops[2].query=TRUE;
+	initops[3].pCmd=(lecroyid->channels==TWO_CHANNEL_SCOPE)?CHNLSTAT_STRING_2:CHNLSTAT_STRING_4;
+	initops[3].query=TRUE;
+
+	if(LeCroy_Operate_Batch(lecroyid,initops,4,READ_TIMEOUT)==ERROR)
 	{
-		/*lecroyid->linkstat=LINK_DOWN;*/	/* LeCroy_Operate already set it */
-		lecroyid->lasterr=LECROY_ERR_INIT_RDTMPL_ERR;
-		/*close (lecroyid->sFd);*/ /* LeCroy_Operate already closed it, it's dangerous to close twice */
+		if(lecroyid->lasterr==LECROY_ERR_RESPONSE_OUT_OF_SEQ && !lecroyid->nopipe)
+		{/* scope doesn't number responses like we thought, connect again and */
+		 /* don't send a command before response of the one before is here     */
+			lecroyid->nopipe=TRUE;
+			printf("Scope[%s] answers batch out of sequence, sending commands one at a time!\n", lecroyid->IPAddr);
+			return	LeCroy_Init(lecroyid, toutsec);
+		}
+		/*lecroyid->linkstat=LINK_DOWN;*/	/* LeCroy_Operate_Batch already set it */
+		/*close (lecroyid->sFd);*/ /* LeCroy_Operate_Batch already closed it, it's dangerous to close twice */
 		/*lecroyid->sFd= ERROR;*/
-		if(LECROY_DRV_DEBUG) printf("Fail to read template of scope[%s]!\n", lecroyid->IPAddr);
+		if(!initops[0].done)
+			lecroyid->lasterr=LECROY_ERR_INIT_INITSCOPE_ERR;
+		else if(!initops[1].done)
+			lecroyid->lasterr=LECROY_ERR_INIT_RDTMPL_ERR;
+		else if(!initops[2].done)
+			lecroyid->lasterr=LECROY_ERR_INIT_IDN_ERR;
+		else
+			lecroyid->lasterr=LECROY_ERR_INIT_CHNLSTAT_ERR;
+		if(LECROY_DRV_DEBUG) printf("Scope[%s]: %s", lecroyid->IPAddr, Error_Msg[lecroyid->lasterr]);
 		return ERROR;
 	}
 
+	/* INIT_STRING put WFSU back to every point */
+	bzero((char *)&(lecroyid->wfsusent), sizeof(lecroyid->wfsusent));
+
 	/* check if we can support this temlpate */
-	if(strstr(prdbk,TEMPLATE)==NULL)
+	if(strstr(initops[1].prdbk,TEMPLATE)==NULL)
 	{/* we can't support this template */
-		free(prdbk);
 		lecroyid->linkstat=LINK_UNSUPPORTED;
 		lecroyid->lasterr=LECROY_ERR_INIT_TMPL_UNSPT;
 		close (lecroyid->sFd);
@@ -498,53 +907,17 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 		if(LECROY_DRV_DEBUG) printf("We can't support the template of the scope[%s]!\n", lecroyid->IPAddr);
 		return ERROR;
 	}
-	else
-		free(prdbk);
 
-	/* try to get model information of scope */
-	if(LeCroy_Operate(lecroyid,IDN_STRING,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
-	{
-		/*lecroyid->linkstat=LINK_DOWN;*/	/* LeCroy_Operate already set it */
-		lecroyid->lasterr=LECROY_ERR_INIT_IDN_ERR;
-		/*close (lecroyid->sFd);*/ /* LeCroy_Operate already closed it, it's dangerous to close twice */
-		/*lecroyid->sFd= ERROR;*/
-		if(LECROY_DRV_DEBUG) printf("Fail to read model information of scope[%s]!\n", lecroyid->IPAddr);
-		return ERROR;
-	}
-	else
+	/* model information of scope */
+	epicsMutexLock(lecroyid->semOp); /* Protect LeCroyModel for function like LeCroy_Get_Model */
+	if((pModel=strstr(initops[2].prdbk,"LECROY"))!=NULL)
 	{
-		epicsMutexLock(lecroyid->semOp); /* Protect LeCroyModel for function like LeCroy_Get_Model */
-		strncpy(lecroyid->LeCroyModel,(char *)strstr(prdbk,"LECROY"),MAX_CA_STRING_SIZE-1);
+		strncpy(lecroyid->LeCroyModel,pModel,MAX_CA_STRING_SIZE-1);
 		lecroyid->LeCroyModel[MAX_CA_STRING_SIZE-1]='\0';
-		epicsMutexUnlock(lecroyid->semOp);
-		free(prdbk);
 	}
+	epicsMutexUnlock(lecroyid->semOp);
 
-	/* get all channels' status of scope */
-	if(lecroyid->channels==TWO_CHANNEL_SCOPE)
-	{/* 2 channels scope */
-		if(LeCroy_Operate(lecroyid,CHNLSTAT_STRING_2,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
-		{
-			/*lecroyid->linkstat=LINK_DOWN;*/	/* LeCroy_Operate already set it */
-			lecroyid->lasterr=LECROY_ERR_INIT_CHNLSTAT_ERR;
-			/*close (lecroyid->sFd);*/ /* LeCroy_Operate already closed it, it's dangerous to close twice */
-			/*lecroyid->sFd= ERROR;*/
-			if(LECROY_DRV_DEBUG) printf("Fail to read current channel status of scope[%s]!\n", lecroyid->IPAddr);
-			return ERROR;
-		}
-	}
-	else
-	{/* 4 channels scope */
-		if(LeCroy_Operate(lecroyid,CHNLSTAT_STRING_4,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
-		{
-			/*lecroyid->linkstat=LINK_DOWN;*/	/*LeCroy_Operate already set it */
-			lecroyid->lasterr=LECROY_ERR_INIT_CHNLSTAT_ERR;
-			/*close (lecroyid->sFd);*/ /* LeCroy_Operate already closed it, it's dangerous to close twice */
-			/*lecroyid->sFd= ERROR;*/
-			printf("Fail to read scope's current channel status!\n");
-			return ERROR;
-		}
-	}		
+	prdbk=initops[3].prdbk;
 
 	/* readback channels' status successfully, try to get each channel status of scope */
 	if(LECROY_DRV_DEBUG) printf("Channel status readback for scope[%s]: %s\n", lecroyid->IPAddr, prdbk);
@@ -561,7 +934,6 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 			lecroyid->chanenbl[loop]=ON;
 		}
 	}
-	free(prdbk);
 	if(LECROY_DRV_DEBUG)
 		printf("Scope[%s] channel status: %d,%d,%d,%d,%d,%d,%d,%d\n", lecroyid->IPAddr,
 			lecroyid->chanenbl[0],lecroyid->chanenbl[1],lecroyid->chanenbl[2],lecroyid->chanenbl[3],
@@ -570,9 +942,51 @@ static STATUS	LeCroy_Init(LeCroyID lecroyid, unsigned int toutsec)
 	return OK;
 }
 
-/*****  internal low level functions finished *****/
+/* Following three functions parse one readback of MSIZ?, TRMD? and TRSE?, */
+/* readback could be whole response ends with 0x0A or one piece of a ';'   */
+/* separated response, so we only look at it up to end of line            */
+static BOOL LeCroy_Match_Rdbk(char * prdbk, const char * response)
+{
+	size_t	len=strcspn(prdbk,"\r\n");
 
-/** user visible driver functions **/
+	return	(strlen(response)==len && strncmp(prdbk,response,len)==0);
+}
+
+static int LeCroy_Parse_MemSize(char * prdbk)
+{
+	int	loop;
+	float	ftempval=0;
+
+	for(loop=0;loop<14;loop++)
+	{
+		if(LeCroy_Match_Rdbk(prdbk,msiz_op[loop].response))	return msiz_op[loop].val;
+	}
+	/* not one of standard sizes, scope tells number of points */
+	sscanf(prdbk, "%g", &ftempval);
+	return	(int)ftempval;
+}
+
+static int LeCroy_Parse_TrgMode(char * prdbk)
+{
+	int	loop;
+
+	for(loop=0;loop<4;loop++)
+	{
+		if(LeCroy_Match_Rdbk(prdbk,trigger_mode[loop].response))	return trigger_mode[loop].val;
+	}
+	return	ERROR;	/* unknown mode, mbbi will show it as illegal state */
+}
+
+static int LeCroy_Parse_TrgSrc(char * prdbk)
+{
+	/* readback is like "EDGE,SR,EX,HT,OFF" or "EDGE,SR,C2,HT,OFF" */
+	if(strlen(prdbk)<10 || prdbk[8]=='E')	return 0;
+	else	return prdbk[9]-'0';
+}
+
+/*****  internal low level functions finished *****/
+
+/** user visible driver functions **/
 
 /* this function keeps monitoring and trying to recover losted link to lecroy scope every interval secs */
 /* there is a timeout for connect, so interval must bigger that timeout */
@@ -638,16 +1052,10 @@ LeCroyID	LeCroy_Open(char * ipaddr, int channels, BOOL auto_link_recover)
 {/* we don't use lasterr here because lasterr is in structure */
 	LeCroyID lecroyid;
         struct LocalThreadData *thrdatap;
+	int	loop;
 
 	char	MonTaskName[80];
 
-	if( sizeof(struct WAVEDESC) != EXPDDESCSIZE )
-	{
-		printf("Please check your compiler, looks like packed option doesn't work!");
-                epicsThreadSuspendSelf();
-		return(NULL);
-	}
-
 	/* parameters check */
 	if( ipaddr == NULL || strlen(ipaddr) == 0 || inet_addr(ipaddr) == ERROR )
 	{
@@ -661,6 +1069,9 @@ LeCroyID	LeCroy_Open(char * ipaddr, int channels, BOOL auto_link_recover)
 		return(NULL);
 	}
 
+	/* pick conversion kernels now, so first waveform doesn't pay for it */
+	LeCroy_Conv_Init();
+
 	/* malloc memory */
 	if((lecroyid=(LeCroyID)malloc(sizeof(struct LECROY)))==NULL)	
 	{/* we have to have piece of memory to hold this structure, or else no way to recover */
@@ -677,105 +1088,854 @@ LeCroyID	LeCroy_Open(char * ipaddr, int channels, BOOL auto_link_recover)
 	strcpy(lecroyid->LeCroyModel,UNKNOWN_MODEL);
 	lecroyid->channels=channels; /* 2 or 4 channels scope */
 	lecroyid->lasterr=LECROY_ERR_NO_ERROR; /* not necessary, already is 0 */
+	lecroyid->format=LECROY_FMT_BYTE; /* LeCroy_Set_Format can change it */
+	for(loop=0;loop<TOTALCHNLS;loop++)
+		lecroyid->wfsu[loop].npoints=WFSU_AUTO;	/* never send more than caller keeps */
+	lecroyid->wfsetup=1;	/* so a zeroed LECROY_WFINFO is never same as what we read */
 	lecroyid->semLecroy=epicsMutexCreate();
 	/* lecroyid->chanenbl will be initialized later, current is all disabled,no default */
 	/* lecroyid->channel_desc will be initialized later, current is all 0,no default */
 	lecroyid->semOp=epicsMutexCreate();
+	lecroyid->srqEvent=epicsEventCreate(epicsEventEmpty);
 
-	if(lecroyid->semLecroy == NULL || lecroyid->semOp == NULL)
+	if(lecroyid->semLecroy == NULL || lecroyid->semOp == NULL || lecroyid->srqEvent == NULL)
 	{
 		if(lecroyid->semLecroy)	epicsMutexDestroy(lecroyid->semLecroy);
 		if(lecroyid->semOp)	epicsMutexDestroy(lecroyid->semOp);
+		if(lecroyid->srqEvent)	epicsEventDestroy(lecroyid->srqEvent);
 		free(lecroyid);
 		printf("Fail to create semaphore for scope[%s]!\n", ipaddr);
 		return(NULL);
 	}
 
+	/* receive arena, it will grow by itself when a big waveform comes */
+	if((lecroyid->prcvbuf=(char *)malloc(RCVBUF_INIT_SIZE))==NULL)
+	{
+		epicsMutexDestroy(lecroyid->semLecroy);
+		epicsMutexDestroy(lecroyid->semOp);
+		epicsEventDestroy(lecroyid->srqEvent);
+		free(lecroyid);
+		printf("Malloc receive buffer for scope[%s] failed!\n", ipaddr);
+		return(NULL);
+	}
+	lecroyid->rcvbufsize=RCVBUF_INIT_SIZE;
+
+	if((lecroyid->prxring=(char *)malloc(RXRING_SIZE))==NULL)
+	{
+		epicsMutexDestroy(lecroyid->semLecroy);
+		epicsMutexDestroy(lecroyid->semOp);
+		epicsEventDestroy(lecroyid->srqEvent);
+		free(lecroyid->prcvbuf);
+		free(lecroyid);
+		printf("Malloc read-ahead buffer for scope[%s] failed!\n", ipaddr);
+		return(NULL);
+	}
+
 	/* save IP address */
 	strncpy(lecroyid->IPAddr, ipaddr, MAX_CA_STRING_SIZE-1);
 	lecroyid->IPAddr[MAX_CA_STRING_SIZE-1]='\0';	/* actually IP never longer than 20 */
 
 	/* here we can already goto SpawnLinkMonitor, then recover will be able to re-connect to scope */
 
-	/* Init connection immediately */
-	LeCroy_Init(lecroyid, CONN_TIMEOUT);
+	/* Init connection immediately */
+	LeCroy_Init(lecroyid, CONN_TIMEOUT);
+
+	/* vxWorks "i" shell command will display only 11 charactors for task name */
+	/* for scope with IP 130.199.123.234, we will have a name "L_M_123.234" */
+	if(auto_link_recover)
+	{
+		strcpy(MonTaskName,"L_M_");
+		strcat(MonTaskName,strchr( (strchr(ipaddr,'.')+1), '.') +1);
+
+                if(( thrdatap = (struct LocalThreadData *)malloc( sizeof *thrdatap)) == NULL)
+                        {
+			printf("Cannot allocate memory for new task\n");
+                        return NULL;
+                        }
+                thrdatap->thr_lecroyid = lecroyid;
+                thrdatap->thr_intervalsec = LINK_CHECK_INTERVAL;
+                thrdatap->thr_toutsec = CONN_TIMEOUT;
+
+		lecroyid->MonTaskID = epicsThreadCreate( MonTaskName, LINK_CHECK_PRIORITY, 20 * 1024, LeCroyRecoverLinkThread, (void *)thrdatap);
+
+		if(lecroyid->MonTaskID==(epicsThreadId)ERROR)
+		{
+			lecroyid->lasterr=LECROY_ERR_OPEN_MONTASK_ERR;
+			printf("Fail to spawn link monitor task for scope[%s], you have to use manual recover!\n", ipaddr);
+		}
+	}
+
+	return	lecroyid;
+}
+
+STATUS	LeCroy_Get_LinkStat(LeCroyID lecroyid, int *plinkstat)
+{
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	*plinkstat=lecroyid->linkstat;
+	return OK;
+}
+
+/* model must be a char array equal or bigger than 40 bytes */
+STATUS	LeCroy_Get_Model(LeCroyID lecroyid, char * model)
+{
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	epicsMutexLock(lecroyid->semOp);
+	strcpy(model,lecroyid->LeCroyModel);
+	epicsMutexUnlock(lecroyid->semOp);
+
+	if(lecroyid->linkstat!=LINK_OK)
+		return	ERROR;	/* user might change scope, so return ERROR to tell user that model is not trustable */
+	else
+		return OK;
+}
+
+/* ipaddr must be a char array equal or bigger than 40 bytes */
+STATUS	LeCroy_Get_IPAddr(LeCroyID lecroyid, char * ipaddr)
+{
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	strcpy(ipaddr,lecroyid->IPAddr);
+	return OK;
+}
+
+/* format is kept in structure, so LeCroy_Init sends it again after link recovery, */
+/* WAVEDESCs we kept are for old format, so they are dropped and next read brings */
+/* new ones. Return ERROR if scope didn't get it, it is still sent on recovery    */
+STATUS	LeCroy_Set_Format(LeCroyID lecroyid, int format)
+{
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	if(format!=LECROY_FMT_BYTE && format!=LECROY_FMT_WORD)
+	{
+		lecroyid->lasterr=LECROY_ERR_WRONG_FORMAT;
+		return ERROR;
+	}
+
+	epicsMutexLock(lecroyid->semLecroy);
+
+	lecroyid->format=format;
+	lecroyid->wfsetup++;
+
+	epicsMutexLock(lecroyid->semOp); /* Protect WAVEDESC for function like LeCroy_Get_LastTrgTime */
+	bzero((char *)lecroyid->channel_desc, sizeof(lecroyid->channel_desc));
+	epicsMutexUnlock(lecroyid->semOp);
+
+	if(LeCroy_Operate(lecroyid,(format==LECROY_FMT_WORD)?CFMT_WORD_STRING:CFMT_BYTE_STRING,FALSE,NULL,NULL,0)==ERROR)
+	{
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return ERROR;
+	}
+
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+/* offset only goes into waveforms read from now on, LECROY_WFINFO we gave out */
+/* keeps trgtime it had                                                      */
+STATUS	LeCroy_Set_TrgOffset(LeCroyID lecroyid, double offset)
+{
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	epicsMutexLock(lecroyid->semLecroy);
+	lecroyid->trgoffset=offset;
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+STATUS	LeCroy_Get_TrgOffset(LeCroyID lecroyid, double * poffset)
+{
+	if(lecroyid==NULL || poffset==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	epicsMutexLock(lecroyid->semLecroy);
+	*poffset=lecroyid->trgoffset;
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+STATUS	LeCroy_Get_Stats(LeCroyID lecroyid, LECROY_STATS * pstats)
+{
+	if(lecroyid==NULL || pstats==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	epicsMutexLock(lecroyid->semLecroy);
+	*pstats=lecroyid->stats;
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+/* SRQ blocks are taken by whoever reads the link, during a transaction that is */
+/* its reader, else we select on socket here without holding semLecroy, so    */
+/* others can use the link while we wait. Once scope asked, INR? clears INB,  */
+/* so it asks again after next acquisition                                   */
+STATUS	LeCroy_Wait_Srq(LeCroyID lecroyid, double timeout)
+{
+	epicsTimeStamp	start, now;
+	double		left;
+	fd_set		readFds;
+	struct timeval	tv;
+	int		sFd;
+	char		* prdbk;
+	int		rdbksize;
+	BOOL		looked=FALSE;	/* timeout 0 still looks at socket once */
+
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	epicsTimeGetCurrent(&start);
+	for(;;)
+	{
+		if(epicsEventTryWait(lecroyid->srqEvent)==epicsEventWaitOK)
+		{
+			lecroyid->srqtaken=FALSE;
+			epicsMutexLock(lecroyid->semLecroy);
+			if(lecroyid->srqenable && lecroyid->linkstat==LINK_OK)
+				LeCroy_Operate(lecroyid,SRQ_REARM_STRING,TRUE,&prdbk,&rdbksize,READ_TIMEOUT);
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return OK;
+		}
+
+		epicsTimeGetCurrent(&now);
+		left=timeout-epicsTimeDiffInSeconds(&now, &start);
+		if(left<=0 && looked)
+		{
+			lecroyid->lasterr=LECROY_ERR_SRQ_TIMEOUT;
+			return ERROR;
+		}
+		if(left<0)	left=0;
+		looked=TRUE;
+
+		sFd=lecroyid->sFd;
+		if(!lecroyid->srqenable || lecroyid->linkstat!=LINK_OK || sFd==ERROR)
+		{/* nothing to listen to, link monitor brings link back */
+			if(left>0)	epicsThreadSleep(min(left, 1.0));
+			continue;
+		}
+
+		FD_ZERO (&readFds);
+		FD_SET (sFd, &readFds);
+		tv.tv_sec=(long)left;
+		tv.tv_usec=(long)((left-tv.tv_sec)*1e6);
+		if (select (sFd+1, &readFds, NULL, NULL, &tv) <= 0)
+			continue;	/* timeout, or socket closed by link down */
+
+		/* something came, if there is a transaction, we wait here until */
+		/* its reader has taken it, else it is for us                    */
+		epicsMutexLock(lecroyid->semLecroy);
+		if(lecroyid->linkstat==LINK_OK && lecroyid->sFd==sFd)
+			LeCroy_Poll_Srq(lecroyid);
+		epicsMutexUnlock(lecroyid->semLecroy);
+	}
+}
+
+/* no lock, sFd and flags are only looked at, caller selects on *pfd and  */
+/* calls LeCroy_Wait_Srq when it is readable. A closed socket only makes  */
+/* that select fail, caller asks again                                    */
+STATUS	LeCroy_Get_SrqFd(LeCroyID lecroyid, int * pfd, BOOL * ptaken)
+{
+	if(lecroyid==NULL || pfd==NULL || ptaken==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	*pfd=(lecroyid->srqenable && lecroyid->linkstat==LINK_OK)?lecroyid->sFd:ERROR;
+	*ptaken=lecroyid->srqtaken;
+	return OK;
+}
+
+/* chnl is 1~8, nothing goes to scope here, LeCroy_Wfsu_Cmd sends it with next WF? */
+STATUS	LeCroy_Set_Wfsu(LeCroyID lecroyid, int chnl, const LECROY_WFSU * pwfsu)
+{
+	if(lecroyid==NULL || pwfsu==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	if( chnl<1 || chnl>TOTALCHNLS || pwfsu->sparsing<WFSU_AUTO
+		|| pwfsu->npoints<WFSU_AUTO || pwfsu->firstpoint<0 )
+	{
+		lecroyid->lasterr=LECROY_ERR_WRONG_WFSU;
+		return ERROR;
+	}
+
+	epicsMutexLock(lecroyid->semLecroy);
+	if(memcmp(&(lecroyid->wfsu[chnl-1]), pwfsu, sizeof(LECROY_WFSU))!=0)
+	{
+		lecroyid->wfsu[chnl-1]=*pwfsu;
+		lecroyid->wfsetup++;
+	}
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+STATUS	LeCroy_Get_Wfsu(LeCroyID lecroyid, int chnl, LECROY_WFSU * pwfsu)
+{
+	if(lecroyid==NULL || pwfsu==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	if(chnl<1 || chnl>TOTALCHNLS)
+	{
+		lecroyid->lasterr=LECROY_ERR_WRONG_WFSU;
+		return ERROR;
+	}
+
+	epicsMutexLock(lecroyid->semLecroy);
+	*pwfsu=lecroyid->wfsu[chnl-1];
+	epicsMutexUnlock(lecroyid->semLecroy);
+	return OK;
+}
+
+/* raw buffer is aligned to RAW_ALIGN, we keep the pointer malloc gave us right before it */
+void *	LeCroy_Malloc_Raw(int pts)
+{
+	char	* pmem;
+	char	* praw;
+
+	if(pts<=0)	return NULL;
+
+	if((pmem=(char *)malloc(pts*MAX_SAMPLE_SIZE+RAW_ALIGN+sizeof(void *)))==NULL)
+		return NULL;
+
+	praw=(char *)(((unsigned long)(pmem+sizeof(void *))+RAW_ALIGN-1)&~((unsigned long)RAW_ALIGN-1));
+	((void **)praw)[-1]=pmem;
+	return	praw;
+}
+
+void	LeCroy_Free_Raw(void *praw)
+{
+	if(praw)	free(((void **)praw)[-1]);
+}
+
+/* convert pts raw samples to volts, return how many we converted */
+/* kernels for this CPU are in LeCroy_conv.c */
+int LeCroy_Convert(const LECROY_WFINFO *pinfo, const void *praw, float *pwaveform, int pts)
+{
+	if(pinfo==NULL || praw==NULL || pwaveform==NULL) return ERROR;
+
+	pts=min(pts,pinfo->points);
+	if(pts<=0)	return pts;
+
+	/* byte mode 8 bits or word mode up to 16 bits resolution, all signed. */
+	/* Long waveforms are split for conversion workers                     */
+	LeCroy_Conv_Stat(praw, pinfo->samplesize, pwaveform, pts, pinfo->gain, pinfo->offset, NULL);
+
+	return	pts;
+}
+
+/* convert pts raw samples to volts like LeCroy_Convert and work out  */
+/* statistics of them in the same pass, sums and extremes come from raw */
+/* samples, they are scaled once at the end                             */
+int LeCroy_Convert_Stat(const LECROY_WFINFO *pinfo, const void *praw, float *pwaveform, int pts, LECROY_WFSTAT *pstat)
+{
+	LECROY_CONV_STAT	raw;
+	double			meansq;
+
+	if(pinfo==NULL || praw==NULL || pstat==NULL) return ERROR;
+
+	pts=min(pts,pinfo->points);
+	bzero((char *)pstat, sizeof(LECROY_WFSTAT));
+	if(pts<=0)	return pts;
+
+	LeCroy_Conv_Stat(praw, pinfo->samplesize, pwaveform, pts, pinfo->gain, pinfo->offset, &raw);
+
+	/* same float math as kernels, so min and max are points of waveform */
+	pstat->min=raw.min*pinfo->gain-pinfo->offset;
+	pstat->max=raw.max*pinfo->gain-pinfo->offset;
+	pstat->peak=(fabs(pstat->max)>=fabs(pstat->min))?raw.maxindex:raw.minindex;
+	if(pinfo->gain<0)
+	{/* smallest sample is biggest volts */
+		double	swap=pstat->min;
+
+		pstat->min=pstat->max;
+		pstat->max=swap;
+	}
+	pstat->mean=raw.sum/pts*pinfo->gain-pinfo->offset;
+	meansq=raw.sumsq/pts*pinfo->gain*pinfo->gain-2.0*pinfo->gain*pinfo->offset*raw.sum/pts+(double)pinfo->offset*pinfo->offset;
+	pstat->rms=(meansq>0)?sqrt(meansq):0;
+	pstat->area=(raw.sum*pinfo->gain-(double)pinfo->offset*pts)*pinfo->dt;
+	pstat->points=pts;
+
+	return	pts;
+}
+
+/* volts of pts points from first added up, for gated integrals, points */
+/* out of waveform are left out. Return how many we added up            */
+int LeCroy_Sum(const LECROY_WFINFO *pinfo, const void *praw, int first, int pts, double *psum)
+{
+	LECROY_CONV_STAT	raw;
+
+	if(pinfo==NULL || praw==NULL || psum==NULL) return ERROR;
+
+	if(first<0)
+	{
+		pts+=first;
+		first=0;
+	}
+	pts=min(pts,pinfo->points-first);
+	*psum=0;
+	if(pts<=0)	return 0;
+
+	LeCroy_Conv_Stat((const char *)praw+first*pinfo->samplesize, pinfo->samplesize, NULL, pts, pinfo->gain, pinfo->offset, &raw);
+	*psum=raw.sum*pinfo->gain-(double)pinfo->offset*pts;
+
+	return	pts;
+}
+
+/* seconds from trigger of each of pts points described by pinfo, every  */
+/* segment of a sequence starts over at t0. Return how many we filled    */
+int LeCroy_Time_Axis(const LECROY_WFINFO *pinfo, double *ptime, int pts)
+{
+	int	loop, seg, segpts;
+
+	if(pinfo==NULL || ptime==NULL) return ERROR;
+
+	pts=min(pts,pinfo->points);
+	segpts=(pinfo->segments>1 && pinfo->segpoints>0)?pinfo->segpoints:pts;
+
+	for(loop=0;loop<segpts && loop<pts;loop++)
+		ptime[loop]=pinfo->t0+loop*pinfo->dt;
+	/* rest of segments are the same */
+	for(seg=segpts;seg<pts;seg+=segpts)
+		memcpy(&ptime[seg], ptime, min(segpts,pts-seg)*sizeof(double));
+
+	return	pts;
+}
+
+/* copy pts raw samples as they are, for clients that scale them themselves */
+/* dstsamplesize is 1 or 2, 8 bits samples are widened for 2, but 16 bits    */
+/* samples can't go into 1 without losing resolution, so that is ERROR      */
+int LeCroy_Copy_Raw(const LECROY_WFINFO *pinfo, const void *praw, void *pdst, int dstsamplesize, int pts)
+{
+	const signed char	* pWaveDataB=(const signed char *)praw;		/* if it's 8 bits waveform */
+	signed short int	* pDstW=(signed short int *)pdst;
+	int			cploop;
+
+	if(pinfo==NULL || praw==NULL || pdst==NULL) return ERROR;
+
+	pts=min(pts,pinfo->points);
+
+	if(dstsamplesize==pinfo->samplesize)
+		memcpy(pdst, praw, pts*dstsamplesize);
+	else if(dstsamplesize==2 && pinfo->samplesize==1)
+	{
+		for(cploop=0;cploop<pts;cploop++)
+			pDstW[cploop]=pWaveDataB[cploop];
+	}
+	else
+		return	ERROR;
+
+	return	pts;
+}
+
+/* where fields of struct WAVEDESC are in WAVEDESC block of LECROY_2_x */
+#define	DESC_FIELD(name, offset)	{ offset, sizeof(((struct WAVEDESC *)0)->name), offsetof(struct WAVEDESC, name) }
+static const struct DESC_FIELD
+{
+	unsigned short	offset;		/* in WAVEDESC block */
+	unsigned short	size;		/* bytes, swapped as a whole if byte order differs */
+	unsigned short	member;		/* in struct WAVEDESC */
+}	desc_field[]={	DESC_FIELD(COMM_TYPE,		32),
+			DESC_FIELD(COMM_ORDER,		DESC_ORDER_OFFSET),
+			DESC_FIELD(WAVE_DESCRIPTOR,	36),
+			DESC_FIELD(USER_TEXT,		40),
+			DESC_FIELD(RES_DESC1,		44),
+			DESC_FIELD(TRIGTIME_ARRAY,	48),
+			DESC_FIELD(RIS_TIME_ARRAY,	52),
+			DESC_FIELD(RES_ARRAY1,		56),
+			DESC_FIELD(WAVE_ARRAY_1,	60),
+			DESC_FIELD(WAVE_ARRAY_2,	64),
+			DESC_FIELD(RES_ARRAY2,		68),
+			DESC_FIELD(RES_ARRAY3,		72),
+			DESC_FIELD(WAVE_ARRAY_COUNT,	116),
+			DESC_FIELD(PNTS_PER_SCREEN,	120),
+			DESC_FIELD(FIRST_VALID_PNT,	124),
+			DESC_FIELD(LAST_VALID_PNT,	128),
+			DESC_FIELD(FIRST_POINT,		132),
+			DESC_FIELD(SPARSING_FACTOR,	136),
+			DESC_FIELD(SUBARRAY_COUNT,	144),
+			DESC_FIELD(SWEEP_PER_ACQ,	148),
+			DESC_FIELD(VERTICAL_GAIN,	156),
+			DESC_FIELD(VERTICAL_OFFSET,	160),
+			DESC_FIELD(HORIZ_INTERVAL,	176),
+			DESC_FIELD(HORIZ_OFFSET,	180),
+			DESC_FIELD(TRIGGER_TIME.seconds,	296),
+			DESC_FIELD(TRIGGER_TIME.minutes,	304),
+			DESC_FIELD(TRIGGER_TIME.hours,	305),
+			DESC_FIELD(TRIGGER_TIME.days,	306),
+			DESC_FIELD(TRIGGER_TIME.months,	307),
+			DESC_FIELD(TRIGGER_TIME.year,	308)};
+
+/* pick fields we use out of WAVEDESC block, COMM_ORDER of block says if they */
+/* need swap, it is 1 (CORD_LOFIRST) only if block is little endian         */
+static void LeCroy_Decode_Desc(struct WAVEDESC * pdesc, const unsigned char * pblock)
+{
+	unsigned char	* pmember;
+	int		swap;
+	int		loop, byte;
+
+	swap=((pblock[DESC_ORDER_OFFSET]==1)?CORD_LOFIRST:CORD_HIFIRST)!=HOST_CORD;
+
+	bzero((char *)pdesc, sizeof(struct WAVEDESC));
+	for(loop=0;loop<NELEMENTS(desc_field);loop++)
+	{
+		pmember=(unsigned char *)pdesc+desc_field[loop].member;
+		if(!swap)
+			memcpy(pmember, pblock+desc_field[loop].offset, desc_field[loop].size);
+		else for(byte=0;byte<desc_field[loop].size;byte++)
+			pmember[byte]=pblock[desc_field[loop].offset+desc_field[loop].size-1-byte];
+	}
+}
+
+/** this function reads WAVEDESC out of response stream, from anywhere before **/
+/** it, decodes it into *pdesc and skips the rest of descriptor. Return OK,  **/
+/** or ERROR with lasterr set, then if link is still OK, caller must drain   **/
+/** the response                                                             **/
+/** It is only called by LeCroy_Read_Wf and LeCroy_Read_Multi with semLecroy **/
+static STATUS LeCroy_Read_Desc(LeCroyID lecroyid, struct WAVEDESC * pdesc)
+{
+	unsigned char		block[REALDESCSIZE];
+	char			* pbuf=(char *)block;
+
+	unsigned int		got;
+	int			loop;
+
+	/* the first 8 bytes of WAVEDESC block is always "WAVEDESC", but there might be something before it */
+	/* like ';' between waveforms of a compound query */
+	if(LeCroy_Read_Stream(lecroyid, pbuf, 8, &got, READ_TIMEOUT)!=LINK_OK)
+		goto link_err;
+	for(loop=0; got==8 && memcmp(pbuf,"WAVEDESC",8)!=0 && loop<MAX_WF_PREFIX; loop++)
+	{/* slide one byte */
+		memmove(pbuf,pbuf+1,7);
+		if(LeCroy_Read_Stream(lecroyid, pbuf+7, 1, &got, READ_TIMEOUT)!=LINK_OK)
+			goto link_err;
+		got+=7;
+	}
+	if(got!=8 || loop==MAX_WF_PREFIX)
+		goto desc_err;
+
+	if(LeCroy_Read_Stream(lecroyid, pbuf+8, REALDESCSIZE-8, &got, READ_TIMEOUT)!=LINK_OK)
+		goto link_err;
+	if(got!=REALDESCSIZE-8 || memcmp(pbuf+DESC_TEMPLATE_OFFSET,TEMPLATE,strlen(TEMPLATE))!=0)
+		goto desc_err;
+	LeCroy_Decode_Desc(pdesc, block);
+	if(pdesc->WAVE_DESCRIPTOR<REALDESCSIZE || pdesc->WAVE_ARRAY_1<0)
+		goto desc_err;
+
+	/* newer scopes have longer descriptor */
+	if(LeCroy_Read_Stream(lecroyid, NULL, pdesc->WAVE_DESCRIPTOR-REALDESCSIZE, &got, READ_TIMEOUT)!=LINK_OK)
+		goto link_err;
+	if(got!=pdesc->WAVE_DESCRIPTOR-REALDESCSIZE)
+		goto desc_err;
+
+	return OK;
+
+desc_err:
+	lecroyid->lasterr=LECROY_ERR_READWF_BAD_DESC;
+	return (ERROR);
+
+link_err:
+	/* LeCroy_Read_Stream already set link down */
+	lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+	return (ERROR);
+}
+
+/* WORD samples came in byte order other than host's */
+static void LeCroy_Swap_Word(void * praw, int pts)
+{
+	unsigned short	* psample=(unsigned short *)praw;
+	int		loop;
+
+	for(loop=0;loop<pts;loop++)
+		psample[loop]=(unsigned short)((psample[loop]<<8)|(psample[loop]>>8));
+}
+
+/* TRIGTIME_ARRAY came in byte order other than host's */
+static void LeCroy_Swap_Double(double * pval, int count)
+{
+	unsigned char	* pbyte;
+	unsigned char	tmp;
+	int		loop, byte;
+
+	for(loop=0;loop<count;loop++)
+	{
+		pbyte=(unsigned char *)&pval[loop];
+		for(byte=0;byte<sizeof(double)/2;byte++)
+		{
+			tmp=pbyte[byte];
+			pbyte[byte]=pbyte[sizeof(double)-1-byte];
+			pbyte[sizeof(double)-1-byte]=tmp;
+		}
+	}
+}
+
+/** this function reads next size bytes of response stream, first keep bytes **/
+/** go to pdst, rest is skipped. Return ERROR with lasterr set if response   **/
+/** ends earlier or link went wrong                                          **/
+static STATUS LeCroy_Read_Part(LeCroyID lecroyid, char * pdst, unsigned int keep, unsigned int size)
+{
+	unsigned int		got;
+
+	if(keep>0)
+	{
+		if(LeCroy_Read_Stream(lecroyid, pdst, keep, &got, READ_TIMEOUT)!=LINK_OK)
+			goto link_err;
+		if(got!=keep)
+			goto desc_err;
+	}
+	if(size>keep)
+	{
+		if(LeCroy_Read_Stream(lecroyid, NULL, size-keep, &got, READ_TIMEOUT)!=LINK_OK)
+			goto link_err;
+		if(got!=size-keep)
+			goto desc_err;
+	}
+	return OK;
+
+desc_err:
+	lecroyid->lasterr=LECROY_ERR_READWF_BAD_DESC;
+	return (ERROR);
+
+link_err:
+	/* LeCroy_Read_Stream already set link down */
+	lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+	return (ERROR);
+}
+
+/** this function reads one whole waveform out of response stream, from      **/
+/** anywhere before its WAVEDESC. Descriptor goes to *pdesc, first pts valid  **/
+/** samples go right into praw, nothing goes through receive arena, and rest  **/
+/** of this waveform is skipped, so next one of a compound query can follow.  **/
+/** Return number of points, or ERROR with lasterr set, then if link is still **/
+/** OK, caller must drain the response to keep link in sync.                  **/
+/** If parrays is not NULL, arrays it asks for are kept on the way, see       **/
+/** LeCroy_Read_Arrays                                                        **/
+/** It is only called by LeCroy_Read_Arrays and LeCroy_Read_Multi with semLecroy **/
+static int LeCroy_Read_Wf(LeCroyID lecroyid, struct WAVEDESC * pdesc, void * praw, int pts, LECROY_ARRAYS * parrays)
+{
+	unsigned int		got;
+	unsigned int		skip;
+	unsigned int		samplesize;
+	unsigned int		arraypts;	/* how many samples in WAVE_ARRAY_1 */
+	unsigned int		arraypts2;	/* and in WAVE_ARRAY_2 */
+	unsigned int		first;
+	unsigned int		segtimes=0;	/* TRIGTIME_ARRAY entries we keep */
+	unsigned int		risoffsets=0;	/* RIS_TIME_ARRAY entries we keep */
+	unsigned int		points2=0;	/* WAVE_ARRAY_2 samples we keep */
+	int			segpts;
+	int			validpts;
+	int			wflength=0;
+
+	if(LeCroy_Read_Desc(lecroyid, pdesc)==ERROR)
+		return (ERROR);
+
+	samplesize=(pdesc->COMM_TYPE==0)?1:2;
+	arraypts=pdesc->WAVE_ARRAY_1/samplesize;
+	arraypts2=(pdesc->WAVE_ARRAY_2>0)?pdesc->WAVE_ARRAY_2/samplesize:0;
+	first=pdesc->FIRST_VALID_PNT;
+	validpts=pdesc->LAST_VALID_PNT-pdesc->FIRST_VALID_PNT+1;
+	if(pdesc->FIRST_VALID_PNT<0 || validpts<0 || first+validpts>arraypts || pdesc->WAVE_ARRAY_2<0)
+		goto desc_err;
+	if(parrays!=NULL && parrays->seq && pdesc->SUBARRAY_COUNT>1 && pts>=(segpts=validpts/pdesc->SUBARRAY_COUNT) && segpts>0)
+		wflength=min(pts/segpts,pdesc->SUBARRAY_COUNT)*segpts;	/* no piece of a segment */
+	else
+		wflength=min(pts,validpts);
+
+	if(parrays!=NULL)
+	{
+		if(parrays->psegtime!=NULL && parrays->maxseg>0)
+		{
+			segtimes=(pdesc->TRIGTIME_ARRAY>0)?min(pdesc->TRIGTIME_ARRAY/(int)sizeof(LECROY_SEGTIME), parrays->maxseg):0;
+			bzero((char *)parrays->psegtime, parrays->maxseg*sizeof(LECROY_SEGTIME));
+		}
+		if(parrays->prisoffset!=NULL && parrays->maxris>0)
+		{
+			risoffsets=(pdesc->RIS_TIME_ARRAY>0)?min(pdesc->RIS_TIME_ARRAY/(int)sizeof(double), parrays->maxris):0;
+			bzero((char *)parrays->prisoffset, parrays->maxris*sizeof(double));
+		}
+		/* array 2 has same points as array 1, like min of extrema or imaginary of FFT */
+		if(parrays->praw2!=NULL && parrays->pts2>0 && arraypts2>first)
+			points2=min(min(parrays->pts2,validpts),arraypts2-first);
+	}
+
+	/* everything before WAVE_ARRAY_1, keep what caller wants on the way */
+	if(LeCroy_Read_Part(lecroyid, NULL, 0, pdesc->USER_TEXT+pdesc->RES_DESC1)==ERROR)
+		return (ERROR);
+	if(LeCroy_Read_Part(lecroyid, segtimes?(char *)parrays->psegtime:NULL, segtimes*sizeof(LECROY_SEGTIME), pdesc->TRIGTIME_ARRAY)==ERROR)
+		return (ERROR);
+	if(LeCroy_Read_Part(lecroyid, risoffsets?(char *)parrays->prisoffset:NULL, risoffsets*sizeof(double), pdesc->RIS_TIME_ARRAY)==ERROR)
+		return (ERROR);
+	if(LeCroy_Read_Part(lecroyid, NULL, 0, pdesc->RES_ARRAY1+first*samplesize)==ERROR)
+		return (ERROR);
+
+	/* here comes the only copy of samples */
+	if(LeCroy_Read_Part(lecroyid, (char *)praw, wflength*samplesize, wflength*samplesize)==ERROR)
+		return (ERROR);
+
+	if(points2>0)
+	{/* invalid points of array 1 and of array 2 before its first valid one */
+		if(LeCroy_Read_Part(lecroyid, NULL, 0, (arraypts-wflength)*samplesize)==ERROR)
+			return (ERROR);
+		if(LeCroy_Read_Part(lecroyid, (char *)parrays->praw2, points2*samplesize, (arraypts2-first)*samplesize)==ERROR)
+			return (ERROR);
+		skip=pdesc->WAVE_ARRAY_2-arraypts2*samplesize;
+	}
+	else
+		skip=(arraypts-first-wflength)*samplesize+pdesc->WAVE_ARRAY_2;
+
+	/* rest of this waveform, like points we don't want and WAVE_ARRAY_2, */
+	/* it is fine if response ends earlier, that is just the last waveform */
+	skip+=pdesc->RES_ARRAY2+pdesc->RES_ARRAY3;
+	if(LeCroy_Read_Stream(lecroyid, NULL, skip, &got, READ_TIMEOUT)!=LINK_OK)
+		goto link_err;
+
+	/* we asked for CORD of host, but WAVEDESC has the last word */
+	if(pdesc->COMM_ORDER!=HOST_CORD)
+	{
+		if(samplesize==2)
+			LeCroy_Swap_Word(praw, wflength);
+		if(samplesize==2 && points2>0)
+			LeCroy_Swap_Word(parrays->praw2, points2);
+		if(segtimes>0)
+			LeCroy_Swap_Double((double *)parrays->psegtime, 2*segtimes);
+		if(risoffsets>0)
+			LeCroy_Swap_Double(parrays->prisoffset, risoffsets);
+	}
+	if(parrays!=NULL)
+	{
+		parrays->ris=risoffsets;
+		parrays->points2=points2;
+	}
+
+	lecroyid->stats.waveforms++;
+	lecroyid->stats.wfbytes+=pdesc->WAVE_ARRAY_1+(points2?pdesc->WAVE_ARRAY_2:0);
+	return (wflength);
+
+desc_err:
+	lecroyid->lasterr=LECROY_ERR_READWF_BAD_DESC;
+	return (ERROR);
+
+link_err:
+	/* LeCroy_Read_Stream already set link down */
+	lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+	return (ERROR);
+}
+
+/* trigger time and sweeps of an acquisition, scope keeps them until it acquires again */
+static void LeCroy_Acq_Stamp(unsigned char * pstamp, struct WAVEDESC * pdesc)
+{
+	memcpy(pstamp, &(pdesc->TRIGGER_TIME), sizeof(pdesc->TRIGGER_TIME));
+	memcpy(pstamp+sizeof(pdesc->TRIGGER_TIME), &(pdesc->SWEEP_PER_ACQ), sizeof(pdesc->SWEEP_PER_ACQ));
+}
+
+/* TRIGGER_TIME is local time of scope, down to sub-ns in seconds, offset takes */
+/* it to IOC clock. A scope never triggered says month 0, we give time now    */
+static void LeCroy_Trg_Time(epicsTimeStamp * pstamp, struct WAVEDESC * pdesc, double offset)
+{
+	struct tm	tmtrg;
 
-	/* vxWorks "i" shell command will display only 11 charactors for task name */
-	/* for scope with IP 130.199.123.234, we will have a name "L_M_123.234" */
-	if(auto_link_recover)
+	if(pdesc->TRIGGER_TIME.months<1 || pdesc->TRIGGER_TIME.months>12)
 	{
-		strcpy(MonTaskName,"L_M_");
-		strcat(MonTaskName,strchr( (strchr(ipaddr,'.')+1), '.') +1);
-
-                if(( thrdatap = (struct LocalThreadData *)malloc( sizeof *thrdatap)) == NULL)
-                        {
-			printf("Cannot allocate memory for new task\n");
-                        return NULL;
-                        }
-                thrdatap->thr_lecroyid = lecroyid;
-                thrdatap->thr_intervalsec = LINK_CHECK_INTERVAL;
-                thrdatap->thr_toutsec = CONN_TIMEOUT;
+		epicsTimeGetCurrent(pstamp);
+		return;
+	}
 
-		lecroyid->MonTaskID = epicsThreadCreate( MonTaskName, LINK_CHECK_PRIORITY, 20 * 1024, LeCroyRecoverLinkThread, (void *)thrdatap);
+	bzero((char *)&tmtrg, sizeof(tmtrg));
+	tmtrg.tm_year=pdesc->TRIGGER_TIME.year-1900;
+	tmtrg.tm_mon=pdesc->TRIGGER_TIME.months-1;
+	tmtrg.tm_mday=pdesc->TRIGGER_TIME.days;
+	tmtrg.tm_hour=pdesc->TRIGGER_TIME.hours;
+	tmtrg.tm_min=pdesc->TRIGGER_TIME.minutes;
+	tmtrg.tm_isdst=-1;	/* let mktime tell */
 
-		if(lecroyid->MonTaskID==(epicsThreadId)ERROR)
-		{
-			lecroyid->lasterr=LECROY_ERR_OPEN_MONTASK_ERR;
-			printf("Fail to spawn link monitor task for scope[%s], you have to use manual recover!\n", ipaddr);
-		}
+	if(epicsTimeFromTM(pstamp, &tmtrg, 0)!=0)
+	{
+		epicsTimeGetCurrent(pstamp);
+		return;
 	}
-
-	return	lecroyid;
+	/* add them one by one, so big offset doesn't eat ns of seconds */
+	epicsTimeAddSeconds(pstamp, pdesc->TRIGGER_TIME.seconds);
+	if(offset!=0.0) epicsTimeAddSeconds(pstamp, offset);
 }
 
-STATUS	LeCroy_Get_LinkStat(LeCroyID lecroyid, int *plinkstat)
+/* how to convert samples of a waveform we just read, called with semLecroy */
+static void LeCroy_Fill_Info(LeCroyID lecroyid, LECROY_WFINFO *pinfo, struct WAVEDESC * pdesc, int points)
 {
-	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	int	sparsing;
+
+	pinfo->samplesize=(pdesc->COMM_TYPE==0)?1:2;
+	pinfo->points=points;
+	pinfo->gain=pdesc->VERTICAL_GAIN;
+	pinfo->offset=pdesc->VERTICAL_OFFSET;
+
+	/* point i we sent is point FIRST_POINT+i*SPARSING_FACTOR of whole trace, */
+	/* HORIZ_OFFSET and HORIZ_INTERVAL are for whole trace                    */
+	sparsing=(pdesc->SPARSING_FACTOR>1)?pdesc->SPARSING_FACTOR:1;
+	pinfo->dt=(double)pdesc->HORIZ_INTERVAL*sparsing;
+	pinfo->t0=pdesc->HORIZ_OFFSET
+		+(double)pdesc->HORIZ_INTERVAL*(pdesc->FIRST_POINT+(double)pdesc->FIRST_VALID_PNT*sparsing);
+
+	pinfo->segments=1;
+	pinfo->segpoints=points;
+	pinfo->points2=0;
+
+	LeCroy_Acq_Stamp(pinfo->acqstamp, pdesc);
+	pinfo->setup=lecroyid->wfsetup;
+	LeCroy_Trg_Time(&(pinfo->trgtime), pdesc, lecroyid->trgoffset);
+}
 
-	*plinkstat=lecroyid->linkstat;
-	return OK;
+/** this function works out WFSU to read pts points of chnl, auto settings  **/
+/** come from pts and WAVEDESC we kept from last read. If *pcur, what scope **/
+/** will have by then, is different, it appends "WFSU ...;" to pCmd and    **/
+/** updates *pcur. Return ERROR if it doesn't fit in bufsize of pCmd.      **/
+/** It is only called by LeCroy_Read_Arrays and LeCroy_Read_Multi with semLecroy **/
+/* SP of WFSU_AUTO for channel, so pts points cover whole trace. We only   */
+/* know the trace from WAVEDESC of a read, so caller has to read again if  */
+/* WAVEDESC it just got gives a different one than what the read went with */
+static int LeCroy_Auto_Sparsing(LeCroyID lecroyid, int chnl, int pts, const struct WAVEDESC * pdesc)
+{
+	int		firstpoint=lecroyid->wfsu[chnl-1].firstpoint;
+	int		trace;	/* points in whole trace */
+	int		sparsing;
+
+	/* PNTS_PER_SCREEN doesn't depend on WFSU, so it is good even for a read with other SP */
+	trace=pdesc->FIRST_POINT+pdesc->WAVE_ARRAY_COUNT*((pdesc->SPARSING_FACTOR>1)?pdesc->SPARSING_FACTOR:1);
+	if(pdesc->PNTS_PER_SCREEN>trace)
+		trace=pdesc->PNTS_PER_SCREEN;
+	sparsing=(trace>firstpoint)?(trace-firstpoint+pts-1)/pts:0;
+	return (sparsing<=1)?0:sparsing;
 }
 
-/* model must be a char array equal or bigger than 40 bytes */
-STATUS	LeCroy_Get_Model(LeCroyID lecroyid, char * model)
+static STATUS LeCroy_Wfsu_Cmd(LeCroyID lecroyid, int chnl, int pts, LECROY_WFSU * pcur, char * pCmd, int bufsize)
 {
-	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	LECROY_WFSU	wfsu=lecroyid->wfsu[chnl-1];
+	char		CMD[80];
 
-	epicsMutexLock(lecroyid->semOp);
-	strcpy(model,lecroyid->LeCroyModel);
-	epicsMutexUnlock(lecroyid->semOp);
+	if(wfsu.npoints==WFSU_AUTO)
+		wfsu.npoints=pts;
 
-	if(lecroyid->linkstat!=LINK_OK)
-		return	ERROR;	/* user might change scope, so return ERROR to tell user that model is not trustable */
-	else
-		return OK;
-}
+	if(wfsu.sparsing==WFSU_AUTO)
+		wfsu.sparsing=LeCroy_Auto_Sparsing(lecroyid, chnl, pts, &(lecroyid->channel_desc[chnl-1]));
 
-/* ipaddr must be a char array equal or bigger than 40 bytes */
-STATUS	LeCroy_Get_IPAddr(LeCroyID lecroyid, char * ipaddr)
-{
-	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	if(memcmp(&wfsu, pcur, sizeof(wfsu))==0)
+		return OK;
 
-	strcpy(ipaddr,lecroyid->IPAddr);
+	sprintf(CMD, "WFSU SP,%d,NP,%d,FP,%d,SN,0;", wfsu.sparsing, wfsu.npoints, wfsu.firstpoint);
+	if(strlen(pCmd)+strlen(CMD)>=bufsize)
+		return ERROR;
+	strcat(pCmd, CMD);
+	*pcur=wfsu;
 	return OK;
 }
 
 /* chnl is 1~8 mapping to array index 0~7, so we use chnl-1 to access array */
-int LeCroy_Read(LeCroyID lecroyid, int chnl, float *pwaveform, int pts)
+/* we read WAVEDESC first, then use it to put first pts valid samples right  */
+/* into praw, nothing of waveform goes through receive arena. Other arrays   */
+/* are kept on the way if parrays asks for them. A sequence (parrays->seq)   */
+/* goes with every point of every segment, WFSU of channel would pick points */
+/* across segments                                                          */
+int LeCroy_Read_Arrays(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_ARRAYS *parrays, LECROY_WFINFO *pinfo)
 {  
-	char			CMD[40];
-	char			* prdbk;	/* to read back response */
-	int			rdbksize;
-
-	char			* pWaveDesc;
-	signed char		* pWaveDataB;	/* if it's 8 bits waveform */
-	signed short int	* pWaveDataW;	/* if it's 16 bits waveform */
-
-	int			wflength=0;
+	char			CMD[MAX_CMD_STRING_SIZE];
+	struct WAVEDESC		desc;		/* read it here, so we don't hold semOp on network */
+	int			wflength;
+	int			segpts;		/* points of one segment */
+	LECROY_WFSU		wfsu;		/* what scope will have after CMD */
+	BOOL			autosp=FALSE;	/* SP of this read came from last WAVEDESC */
 
-	int			cploop;		/*for copy data to float array*/
-	
 	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	if(praw==NULL || pinfo==NULL || pts<=0) return ERROR;
 	
 	if(lecroyid->channels==FOUR_CHANNEL_SCOPE && (chnl<1||chnl>TOTALCHNLS) )
 	{
@@ -791,7 +1951,6 @@ int LeCroy_Read(LeCroyID lecroyid, int chnl, float *pwaveform, int pts)
 
 	epicsMutexLock(lecroyid->semLecroy); /* still need it cause we will touch struct */
 
-
 	if(lecroyid->chanenbl[chnl-1]!=ON) 
 	{/* save network bandwith */
 		lecroyid->lasterr=LECROY_ERR_READWF_CHNL_DISABLED;
@@ -799,65 +1958,360 @@ int LeCroy_Read(LeCroyID lecroyid, int chnl, float *pwaveform, int pts)
 		return	ERROR;
 	}
 	
-	bzero(CMD,40);
-	strcpy(CMD,ChannelName[chnl-1]);	/* put Cx: */
+	bzero(CMD,MAX_CMD_STRING_SIZE);
+	wfsu=lecroyid->wfsusent;
+	if(parrays==NULL || !parrays->seq)
+	{
+		LeCroy_Wfsu_Cmd(lecroyid, chnl, pts, &wfsu, CMD, MAX_CMD_STRING_SIZE);	/* put WFSU ...; if changed */
+		autosp=(lecroyid->wfsu[chnl-1].sparsing==WFSU_AUTO);
+	}
+	else
+	{/* every point of every segment */
+		bzero((char *)&wfsu, sizeof(wfsu));
+		if(memcmp(&wfsu, &(lecroyid->wfsusent), sizeof(wfsu))!=0)
+			strcpy(CMD,"WFSU SP,0,NP,0,FP,0,SN,0;");
+	}
+	strcat(CMD,ChannelName[chnl-1]);	/* put Cx: */
 	strcat(CMD,"WF?");
 
-	if (LeCroy_Operate(lecroyid,CMD,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
+	if(lecroyid->linkstat!=LINK_OK || LeCroy_Write_Command(lecroyid,CMD)!=LINK_OK)
 	{  
 		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
 		epicsMutexUnlock(lecroyid->semLecroy);
 		return (ERROR);
-	} 
+	}
+	lecroyid->wfsusent=wfsu;
+
+	LeCroy_Begin_Stream(lecroyid);
+
+	if((wflength=LeCroy_Read_Wf(lecroyid, &desc, praw, pts, parrays))==ERROR)
+	{
+		/* response is still in sync as long as we drain it to EOI */
+		if(lecroyid->linkstat==LINK_OK)
+			LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT);
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (ERROR);
+	}
 
-	/* the first 8 bytes of WAVEDESC block is always "WAVEDESC" */
-	pWaveDesc=(char *)strstr(prdbk,"WAVEDESC");
+	/* whatever left, like end of line */
+	if(LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT)!=LINK_OK)
+	{
+		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (ERROR);
+	}
 
 	epicsMutexLock(lecroyid->semOp); /* Protect WAVEDESC for function like LeCroy_Get_LastTrgTime */
+	lecroyid->channel_desc[chnl-1]=desc;
+	epicsMutexUnlock(lecroyid->semOp);
 
-	/* even on little endian platform, if you use CORD LO;, this will be still good */
-	memcpy( &(lecroyid->channel_desc[chnl-1]), pWaveDesc, REALDESCSIZE/*sizeof(struct WAVEDESC)*/);
-	/* actually we can release semOp here, just for saver we release it later */
-	wflength=lecroyid->channel_desc[chnl-1].LAST_VALID_PNT-lecroyid->channel_desc[chnl-1].FIRST_VALID_PNT+1;
-	
+	if(autosp && LeCroy_Auto_Sparsing(lecroyid, chnl, pts, &desc)!=wfsu.sparsing)
+	{/* first read or timebase changed, these points don't cover the trace */
+		if(lecroyid->resparsing)
+		{
+			lecroyid->lasterr=LECROY_ERR_READWF_SPARSING;
+			wflength=ERROR;
+		}
+		else
+		{/* once more with SP of WAVEDESC we just got */
+			lecroyid->resparsing=TRUE;
+			wflength=LeCroy_Read_Arrays(lecroyid, chnl, praw, pts, parrays, pinfo);
+			lecroyid->resparsing=FALSE;
+		}
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (wflength);
+	}
 
-	pWaveDataB=(signed char *)pWaveDesc + lecroyid->channel_desc[chnl-1].WAVE_DESCRIPTOR
-										+ lecroyid->channel_desc[chnl-1].USER_TEXT
-										+ lecroyid->channel_desc[chnl-1].RES_DESC1
-										+ lecroyid->channel_desc[chnl-1].TRIGTIME_ARRAY
-										+ lecroyid->channel_desc[chnl-1].RIS_TIME_ARRAY
-										+ lecroyid->channel_desc[chnl-1].RES_ARRAY1;
-	pWaveDataW=(signed short int *)pWaveDataB;
+	LeCroy_Fill_Info(lecroyid, pinfo, &desc, wflength);
+	if(parrays!=NULL)
+	{
+		pinfo->points2=parrays->points2;
+		segpts=(parrays->seq && desc.SUBARRAY_COUNT>1)?(desc.LAST_VALID_PNT-desc.FIRST_VALID_PNT+1)/desc.SUBARRAY_COUNT:0;
+		if(segpts>0 && wflength>=segpts)
+		{/* LeCroy_Read_Wf took whole segments */
+			pinfo->segpoints=segpts;
+			pinfo->segments=wflength/segpts;
+		}
+	}
+	epicsMutexUnlock(lecroyid->semLecroy);
 
-	if(lecroyid->channel_desc[chnl-1].COMM_TYPE==0)
-	{/* byte mode, 8 bits resolution,all signed */
-		
-		/*copy data to float array*/
-		for(cploop=0;cploop<min(pts,wflength);cploop++)
-		/* for(cploop=0;cploop<pts;cploop++) */
+	return (wflength);
+}  
+
+int LeCroy_Read_Raw(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_WFINFO *pinfo)
+{
+	return LeCroy_Read_Arrays(lecroyid, chnl, praw, pts, NULL, pinfo);
+}
+
+int LeCroy_Read_Seg(LeCroyID lecroyid, int chnl, void *praw, int pts, LECROY_SEGTIME *psegtime, int maxseg, LECROY_WFINFO *pinfo)
+{
+	LECROY_ARRAYS		arrays;
+
+	bzero((char *)&arrays, sizeof(arrays));
+	arrays.seq=TRUE;
+	arrays.psegtime=psegtime;
+	arrays.maxseg=(psegtime!=NULL)?maxseg:0;
+	return LeCroy_Read_Arrays(lecroyid, chnl, praw, pts, &arrays, pinfo);
+}
+
+/** this function asks WF? DESC of channels in *pcheck, which pinfo[] holds  **/
+/** last read of, and takes out of *pcheck those scope has acquired again    **/
+/** since. Same acquisition with same setup means same samples, so channels  **/
+/** left in *pcheck need no transfer. One round trip, about 400 bytes each.  **/
+/** Return ERROR with lasterr set if link went wrong.                       **/
+/** It is only called by LeCroy_Read_Multi with semLecroy                   **/
+static STATUS LeCroy_Check_Desc(LeCroyID lecroyid, unsigned int * pcheck, const LECROY_WFINFO pinfo[])
+{
+	char			CMD[MAX_CMD_STRING_SIZE];
+	struct WAVEDESC		desc;
+	unsigned char		stamp[ACQSTAMPSIZE];
+	int			loop;
+
+	bzero(CMD,MAX_CMD_STRING_SIZE);
+	for(loop=0;loop<TOTALCHNLS;loop++)
+	{
+		if( !(*pcheck&(1<<loop)) )
+			continue;
+		if(CMD[0])	strcat(CMD,";");
+		strcat(CMD,ChannelName[loop]);	/* put Cx: */
+		strcat(CMD,"WF? DESC");
+	}
+
+	if(lecroyid->linkstat!=LINK_OK || LeCroy_Write_Command(lecroyid,CMD)!=LINK_OK)
+	{
+		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+		return (ERROR);
+	}
+
+	LeCroy_Begin_Stream(lecroyid);
+
+	/* descriptors come in the order we asked for them */
+	for(loop=0;loop<TOTALCHNLS;loop++)
+	{
+		if( !(*pcheck&(1<<loop)) )
+			continue;
+		if(LeCroy_Read_Desc(lecroyid, &desc)==ERROR)
 		{
-			pwaveform[cploop]=pWaveDataB[cploop+lecroyid->channel_desc[chnl-1].FIRST_VALID_PNT]
-				*lecroyid->channel_desc[chnl-1].VERTICAL_GAIN-lecroyid->channel_desc[chnl-1].VERTICAL_OFFSET;
+			/* response is still in sync as long as we drain it to EOI */
+			if(lecroyid->linkstat==LINK_OK)
+				LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT);
+			return (ERROR);
 		}
+		lecroyid->stats.checks++;
+		LeCroy_Acq_Stamp(stamp, &desc);
+		if(memcmp(stamp, pinfo[loop].acqstamp, ACQSTAMPSIZE)!=0)
+			*pcheck&=~(1<<loop);
+		else
+			lecroyid->stats.skipped++;
 	}
-	else
-	{/* word mode, up to 16 bits resolution,all signed */
-		
-		/*copy data to float array*/
-		for(cploop=0;cploop<min(pts,wflength);cploop++)
+
+	/* whatever left, like end of line */
+	if(LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT)!=LINK_OK)
+	{
+		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+		return (ERROR);
+	}
+	return OK;
+}
+
+/* bit 0~7 of chnlmask is channel 1~8, praw[], pts[] and pinfo[] are indexed  */
+/* 0~7 for channel 1~8 too, and only entries in chnlmask are touched. All     */
+/* channels are read by one compound WF? query, so one round trip for all of  */
+/* them. Return mask of channels we really read, disabled channels are just   */
+/* left out, so is a channel whose trigger time is not same as first channel, */
+/* because scope triggered again while it was answering.                     */
+/* If psame is not NULL, channels in *psame have their last read in praw[]   */
+/* and pinfo[], a WF? DESC round trip goes first and only channels scope has */
+/* acquired again since are transferred. On return *psame has channels left  */
+/* alone, their praw[] and pinfo[] are still good. It pays off when scope    */
+/* triggers slower than we read, else it costs one more round trip.          */
+int LeCroy_Read_Multi(LeCroyID lecroyid, unsigned int chnlmask, void *praw[], const int pts[], LECROY_WFINFO pinfo[], unsigned int *psame)
+{
+	char			CMD[MAX_CMD_STRING_SIZE];
+	struct WAVEDESC		desc[TOTALCHNLS];	/* read it here, so we don't hold semOp on network */
+	int			wflength[TOTALCHNLS];
+	unsigned int		asked=0;	/* channels in compound query */
+	unsigned int		got=0;		/* channels we really return */
+	int			firstchnl=-1;
+	int			loop;
+	LECROY_WFSU		wfsu;		/* what scope will have by each WF? */
+	int			sparsing[TOTALCHNLS];	/* SP each WF? went with */
+	unsigned int		stale=0;	/* channels WFSU_AUTO picked wrong SP for */
+	int			cmdlen;
+	unsigned int		same=0;		/* channels scope has nothing new for */
+
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	if(praw==NULL || pts==NULL || pinfo==NULL) return ERROR;
+
+	if( chnlmask==0 || (chnlmask>>TOTALCHNLS)!=0 )
+	{
+		lecroyid->lasterr=LECROY_ERR_READWF_CHNLNUM_ERR;
+		return(ERROR);
+	}
+
+	if( lecroyid->channels==TWO_CHANNEL_SCOPE && (chnlmask&0xCC)!=0 )
+	{/* for 2 channels scope, we have no C3;C4;TC;TD */
+		lecroyid->lasterr=LECROY_ERR_READWF_CHNLNUM_ERR;
+		return(ERROR);
+	}
+
+	epicsMutexLock(lecroyid->semLecroy); /* still need it cause we will touch struct */
+
+	if(psame)
+	{/* only channels we could read, and pinfo[] read with same WFSU and format */
+		for(loop=0;loop<TOTALCHNLS;loop++)
+		{
+			if( (*psame&chnlmask&(1<<loop)) && praw[loop]!=NULL && pts[loop]>0
+				&& lecroyid->chanenbl[loop]==ON && pinfo[loop].setup==lecroyid->wfsetup )
+				same|=(1<<loop);
+		}
+		*psame=0;
+		if(same && LeCroy_Check_Desc(lecroyid, &same, pinfo)==ERROR)
+		{
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return (ERROR);
+		}
+	}
+
+	bzero(CMD,MAX_CMD_STRING_SIZE);
+	wfsu=lecroyid->wfsusent;
+	for(loop=0;loop<TOTALCHNLS;loop++)
+	{
+		if( !(chnlmask&(1<<loop)) || praw[loop]==NULL || pts[loop]<=0 )
+			continue;
+		if(lecroyid->chanenbl[loop]!=ON)
+			continue;	/* save network bandwith */
+		if(same&(1<<loop))
+			continue;	/* what caller has is still good */
+		cmdlen=strlen(CMD);
+		if(cmdlen+8>=MAX_CMD_STRING_SIZE)
+			continue;
+		if(asked)	strcat(CMD,";");
+		/* each channel's WFSU goes right in front of its WF?, a channel whose */
+		/* WFSU doesn't fit in scope's command buffer any more is left out   */
+		if(LeCroy_Wfsu_Cmd(lecroyid, loop+1, pts[loop], &wfsu, CMD, MAX_CMD_STRING_SIZE-8)==ERROR)
+		{
+			CMD[cmdlen]='\0';
+			continue;
+		}
+		sparsing[loop]=wfsu.sparsing;
+		strcat(CMD,ChannelName[loop]);	/* put Cx: */
+		strcat(CMD,"WF?");
+		asked|=(1<<loop);
+	}
+
+	if(asked==0) 
+	{
+		if(psame)	*psame=same;
+		if(same)
+		{/* nothing new at all, we are done with one short round trip */
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return (0);
+		}
+		lecroyid->lasterr=LECROY_ERR_READWF_CHNL_DISABLED;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return	ERROR;
+	}
+
+	if(lecroyid->linkstat!=LINK_OK || LeCroy_Write_Command(lecroyid,CMD)!=LINK_OK)
+	{  
+		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (ERROR);
+	}
+	lecroyid->wfsusent=wfsu;
+	if(psame)	*psame=same;
+
+	LeCroy_Begin_Stream(lecroyid);
+
+	/* waveforms come in the order we asked for them */
+	for(loop=0;loop<TOTALCHNLS;loop++)
+	{
+		if( !(asked&(1<<loop)) )
+			continue;
+		if((wflength[loop]=LeCroy_Read_Wf(lecroyid, &desc[loop], praw[loop], pts[loop], NULL))==ERROR)
+		{
+			/* response is still in sync as long as we drain it to EOI */
+			if(lecroyid->linkstat==LINK_OK)
+				LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT);
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return (ERROR);
+		}
+	}
+
+	/* whatever left, like end of line */
+	if(LeCroy_Drain_Stream(lecroyid, READ_TIMEOUT)!=LINK_OK)
+	{
+		lecroyid->lasterr=LECROY_ERR_READWF_FAILED;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (ERROR);
+	}
+
+	epicsMutexLock(lecroyid->semOp); /* Protect WAVEDESC for function like LeCroy_Get_LastTrgTime */
+	for(loop=0;loop<TOTALCHNLS;loop++)
+	{
+		if( !(asked&(1<<loop)) )
+			continue;
+		if(firstchnl<0)
+			firstchnl=loop;
+		else if(memcmp(&(desc[loop].TRIGGER_TIME),&(desc[firstchnl].TRIGGER_TIME),sizeof(desc[loop].TRIGGER_TIME))!=0)
 		{
-			pwaveform[cploop]=pWaveDataW[cploop+lecroyid->channel_desc[chnl-1].FIRST_VALID_PNT]
-				*lecroyid->channel_desc[chnl-1].VERTICAL_GAIN-lecroyid->channel_desc[chnl-1].VERTICAL_OFFSET;
+			lecroyid->lasterr=LECROY_ERR_READWF_MIXED_TRIGGER;
+			continue;
 		}
+		lecroyid->channel_desc[loop]=desc[loop];
+		LeCroy_Fill_Info(lecroyid, &pinfo[loop], &desc[loop], wflength[loop]);
+		got|=(1<<loop);
+		if(lecroyid->wfsu[loop].sparsing==WFSU_AUTO && LeCroy_Auto_Sparsing(lecroyid, loop+1, pts[loop], &desc[loop])!=sparsing[loop])
+			stale|=(1<<loop);	/* first read or timebase changed */
+	}
+	epicsMutexUnlock(lecroyid->semOp);
+
+	if(stale && !lecroyid->resparsing)
+	{/* all of them again, so they still come from one trigger */
+		lecroyid->resparsing=TRUE;
+		got=LeCroy_Read_Multi(lecroyid, got, praw, pts, pinfo, NULL);
+		lecroyid->resparsing=FALSE;
 	}
+	else if(stale)
+	{/* timebase changed again while we read, these points don't cover the trace */
+		lecroyid->lasterr=LECROY_ERR_READWF_SPARSING;
+		got&=~stale;
+	}
+
+	epicsMutexUnlock(lecroyid->semLecroy);
+
+	return (got);
+}
+
+/* chnl is 1~8 mapping to array index 0~7, so we use chnl-1 to access array */
+/* same as LeCroy_Read_Raw, but samples go through receive arena, that is   */
+/* fine for occasional callers, record support should use LeCroy_Read_Raw   */
+int LeCroy_Read(LeCroyID lecroyid, int chnl, float *pwaveform, int pts)
+{  
+	LECROY_WFINFO	info;
+	int		num;
+
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+	if(pwaveform==NULL || pts<=0) return ERROR;
+
+	/* semLecroy is recursive, we hold it so nobody else reuses arena before we convert */
+	epicsMutexLock(lecroyid->semLecroy);
 
-	epicsMutexUnlock(lecroyid->semOp); /* Protect WAVEDESC for function like LeCroy_Get_LastTrgTime */
+	/* malloc gives arena at least 8 bytes alignment, that is plenty for WORD samples */
+	if(LeCroy_Grow_Rcvbuf(lecroyid, pts*MAX_SAMPLE_SIZE)!=OK)
+	{
+		lecroyid->lasterr=LECROY_ERR_RESPONSE_MALLOC_ERR;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return (ERROR);
+	}
 
-	free(prdbk);
+	if((num=LeCroy_Read_Raw(lecroyid, chnl, lecroyid->prcvbuf, pts, &info))>0)
+		num=LeCroy_Convert(&info, lecroyid->prcvbuf, pwaveform, num);
 
 	epicsMutexUnlock(lecroyid->semLecroy);
 
-	return (min(pts,wflength));
+	return (num);
 }  
 
 /* chnl number 0 is used for non-channel related operation */
@@ -868,8 +2322,6 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 	char		CMD[100];
 	char		* prdbk;
 	int		rdbksize;
-
-	int		loop;	/* for readback comparasion */
 	
 	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */ 
 
@@ -979,7 +2431,6 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			lecroyid->chanenbl[chnl-1]=ON;
 			*(int *)parg=ON;
 		}
-		free(prdbk);
 		break;
 
 	case SETMEMSIZE:	/* non-channel related operation, see header file */
@@ -1003,21 +2454,7 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			epicsMutexUnlock(lecroyid->semLecroy);
 			return	ERROR;
 		}
-		for(loop=0;loop<14;loop++)
-		{
-			if(strncmp(prdbk,msiz_op[loop].response,strlen(prdbk)-1)==0)	break;/*minus 1 is because prdbk end with 0x0A*/
-		}
-                if(loop < 14)
-		{
-                    *(int *)parg=msiz_op[loop].val;
-                }
-                else
-                {
-                    float ftempval; 
-                    sscanf(prdbk, "%g", &ftempval);
-                    *(int *)parg=(int)ftempval;
-                }
-		free(prdbk);
+		*(int *)parg=LeCroy_Parse_MemSize(prdbk);
 		break;
 
 	case SETTIMEDIV:	/* non-channel related operation */
@@ -1036,7 +2473,6 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			return	ERROR;
 		}
 		sscanf(prdbk,"%e",(float *)parg);
-		free(prdbk);
 		break;
 
 	case SETVOLTDIV:	/* this command is not good for math channel */
@@ -1074,7 +2510,6 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			return	ERROR;
 		}
 		sscanf(prdbk,"%e",(float *)parg);
-		free(prdbk);
 		break;
 
 	case SETTRGMODE:	/* non-channel related operation, see header file */
@@ -1098,12 +2533,7 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			epicsMutexUnlock(lecroyid->semLecroy);
 			return	ERROR;
 		}
-		for(loop=0;loop<4;loop++)
-		{
-			if(strncmp(prdbk,trigger_mode[loop].response,strlen(prdbk)-1)==0)	break;/*minus 1 is because prdbk end with 0x0A*/
-		}
-		*(int *)parg=trigger_mode[loop].val;
-		free(prdbk);
+		*(int *)parg=LeCroy_Parse_TrgMode(prdbk);
 		break;
 
 	case SETTRGSRC:	/* non-channel related operation */
@@ -1139,9 +2569,7 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			epicsMutexUnlock(lecroyid->semLecroy);
 			return	ERROR;
 		}
-		if(prdbk[8]=='E')	*(int *)parg=0;
-		else	*(int *)parg=prdbk[9]-'0';
-		free(prdbk);
+		*(int *)parg=LeCroy_Parse_TrgSrc(prdbk);
 		break;
 
 	case LDPNLSTP:	/* non-channel related operation */
@@ -1183,7 +2611,7 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 		Parameter (chnl & *parg) check;
 		Prepare CMD to send to scope;
 		Call LeCroy_Operate, parameter depend on query or not; 
-		If query, analyze readback then set *parg and free(prdbk);
+		If query, analyze readback then set *parg, prdbk is borrowed, don't free it;
 		break;
 */
 
@@ -1213,7 +2641,40 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 			*(int *)parg=OFF;
 		else
 			*(int *)parg=ON;
-		free(prdbk);
+		break;
+
+	case SETFORMAT:	/* non-channel related operation */
+		if(LeCroy_Set_Format(lecroyid,*(int *)parg)==ERROR)
+		{
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return	ERROR;
+		}
+		break;
+
+	case GETFORMAT:	/* non-channel related operation, what we asked for, not CFMT? */
+		*(int *)parg=lecroyid->format;
+		break;
+
+	case ENABLESRQ:	/* non-channel related operation, kept over link recovery */
+		lecroyid->srqenable=TRUE;
+		if(LeCroy_Operate(lecroyid,SRQ_ON_STRING,FALSE,NULL,NULL,0)==ERROR)
+		{
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return	ERROR;
+		}
+		break;
+
+	case DISABLESRQ:	/* non-channel related operation */
+		lecroyid->srqenable=FALSE;
+		if(LeCroy_Operate(lecroyid,SRQ_OFF_STRING,FALSE,NULL,NULL,0)==ERROR)
+		{
+			epicsMutexUnlock(lecroyid->semLecroy);
+			return	ERROR;
+		}
+		break;
+
+	case GETSRQSTAT:	/* non-channel related operation, what we asked for */
+		*(int *)parg=lecroyid->srqenable?ON:OFF;
 		break;
 
 	default:
@@ -1228,6 +2689,65 @@ STATUS	LeCroy_Ioctl(LeCroyID lecroyid, int chnl, int op, void * parg)
 
 }
 
+/* This function reads everything GETCHANSTAT(C1~C4), GETVOLTDIV, GETMEMSIZE, */
+/* GETTIMEDIV, GETTRGMODE, GETTRGSRC and GETACALSTAT would, but with one query */
+/* so it costs one round trip instead of thirteen, response is parsed once    */
+STATUS	LeCroy_Get_Status(LeCroyID lecroyid, LECROY_STATUS * pstatus)
+{
+	char		* prdbk;
+	int		rdbksize;
+
+	char		* ptoken[2*STATUS_CHNLS+STATUS_NONCHNL_ITEMS+1];
+	char		* pLast = NULL;	/* for strtok_r */
+	int		ntoken;
+	int		nchnls;		/* how many channels are in response */
+	int		loop;
+
+	if(lecroyid==NULL) return ERROR; /* fail to LeCroy_Open */
+
+	if(pstatus==NULL) return ERROR;
+
+	nchnls=(lecroyid->channels==TWO_CHANNEL_SCOPE)?2:STATUS_CHNLS;
+
+	epicsMutexLock(lecroyid->semLecroy);
+
+	if(LeCroy_Operate(lecroyid,(nchnls==2)?STATUS_STRING_2:STATUS_STRING_4,TRUE,&prdbk,&rdbksize,READ_TIMEOUT)==ERROR)
+	{
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return	ERROR;
+	}
+	if(LECROY_DRV_DEBUG>1) printf("Status readback for scope[%s]: %s\n", lecroyid->IPAddr, prdbk);
+
+	/* one extra token tells us response has more than we asked */
+	for(ntoken=0;ntoken<2*nchnls+STATUS_NONCHNL_ITEMS+1;ntoken++)
+	{
+		if((ptoken[ntoken]=strtok_r((ntoken==0?prdbk:NULL), ";", &pLast))==NULL)	break;
+	}
+	if(ntoken!=2*nchnls+STATUS_NONCHNL_ITEMS)
+	{/* we don't force link down, next query might be fine */
+		lecroyid->lasterr=LECROY_ERR_STATUS_PARSE_ERR;
+		epicsMutexUnlock(lecroyid->semLecroy);
+		return	ERROR;
+	}
+
+	bzero((char *)pstatus,sizeof(LECROY_STATUS));
+	for(loop=0;loop<nchnls;loop++)
+	{
+		pstatus->chanstat[loop]=(strstr(ptoken[loop],"ON")==NULL)?OFF:ON;
+		lecroyid->chanenbl[loop]=pstatus->chanstat[loop];	/* same as GETCHANSTAT */
+		sscanf(ptoken[nchnls+loop],"%e",&(pstatus->voltdiv[loop]));
+	}
+	pstatus->memsize=LeCroy_Parse_MemSize(ptoken[2*nchnls]);
+	sscanf(ptoken[2*nchnls+1],"%e",&(pstatus->timediv));
+	pstatus->trgmode=LeCroy_Parse_TrgMode(ptoken[2*nchnls+2]);
+	pstatus->trgsrc=LeCroy_Parse_TrgSrc(ptoken[2*nchnls+3]);
+	pstatus->acalstat=(strstr(ptoken[2*nchnls+4],"ON")==NULL)?OFF:ON;
+
+	epicsMutexUnlock(lecroyid->semLecroy);
+
+	return OK;
+}
+
 /* time should be a char array equal or bigger than 31 bytes */
 /* chnl is 1~8 mapping to array index 0~7, so we use chnl-1 to access array */
 STATUS	LeCroy_Get_LastTrgTime(LeCroyID lecroyid, int chnl, char * time)
@@ -1287,6 +2807,9 @@ STATUS	LeCroy_Close(LeCroyID lecroyid)
 
 	epicsMutexDestroy(lecroyid->semLecroy);
 	epicsMutexDestroy(lecroyid->semOp);
+	epicsEventDestroy(lecroyid->srqEvent);
+	free(lecroyid->prcvbuf);
+	free(lecroyid->prxring);
 	free(lecroyid);
 	return OK;
 }
@@ -57,7 +57,8 @@
 /*                                                                                */
 /* Known Limitations:                                                             */
 /*    1. I don't think we need CLEAR in our cases.                                */
-/*    2. When we get SRQ, we just simply ignore it.                               */
+/*    2. SRQ is only used for new acquisition (INE 1;*SRE 1), its frames are      */
+/*       taken out of the stream wherever they come, see LeCroy_Take_Srq.         */
 /*    3. We don't do SERIALPOLL(OOB or in-bound) here.                            */
 /*                                                                                */
 /**********************************************************************************/
@@ -84,6 +85,8 @@
 /*include*/
 #include <epicsThread.h>
 #include <epicsMutex.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
 #include <epicsStdio.h>
 #include <dbDefs.h>
 #include <string.h>
@@ -91,9 +94,12 @@
 #include <drvSup.h>
 #include <dbScan.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include "netinet/tcp.h"
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
 #include <ctype.h>
 
 #include "LeCroy_GenType.h"
@@ -105,38 +111,62 @@
 #define	TWO_CHANNEL_SCOPE	2
 #define	FOUR_CHANNEL_SCOPE	4
 #define	READ_TIMEOUT		6	/* read socket with timeout 6 seconds */
+#define	RCVBUF_INIT_SIZE	8192	/* initial size of receive arena, doubles whenever a response doesn't fit */
+#define	RXRING_SIZE		16384	/* read-ahead buffer, one read usually gets a whole short reply */
+#define	RXRING_BYPASS		4096	/* reads at least this big skip read-ahead buffer and go to caller */
+#define	SOCK_RCVBUF_SIZE	65536	/* kernel receive buffer, bigger means fewer reads per VICP block */
 #define	CONN_TIMEOUT		6	/* Connect with timeout 6 seconds */
+#define	MAX_BATCH_OPS		32	/* most commands LeCroy_Operate_Batch writes back-to-back */
 
 /* Use CFMT OFF to turn off block information, but even use CFMT DEF9 or CFMT IND0,
    no code modification needed, but turning it off will help speed slightly;
-   for more than 8 bits resolution, use "CFMT OFF,WORD,BIN;" */
+   CFMT is sent by itself in front of INIT_STRING, see CFMT_BYTE_STRING */
 /* CHDR OFF will turn off command echo, if turn it on, waveform read will be still
    ok, but we have to change something to analyze response for other commands */
-/* for little endian platform, use "CORD LO;", this affects all parts of WF readback */
+/* for little endian platform, use "CORD LO;", so WORD samples need no swap. */
+/* WAVEDESC says its byte order in COMM_ORDER, so it is decoded right anyway */
+#define	CORD_HIFIRST	0
+#define	CORD_LOFIRST	1
 #if defined(vxWorks)
 
 #if	_BYTE_ORDER == _BIG_ENDIAN
-#define	INIT_STRING	"CFMT OFF,BYTE,BIN;CHDR OFF;CORD HI;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	INIT_STRING	"CHDR OFF;CORD HI;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	HOST_CORD	CORD_HIFIRST
 #else
-#define	INIT_STRING	"CFMT OFF,BYTE,BIN;CHDR OFF;CORD LO;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	INIT_STRING	"CHDR OFF;CORD LO;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	HOST_CORD	CORD_LOFIRST
 #endif
 
 #elif defined(linux)
 
 #if	__BYTE_ORDER == __BIG_ENDIAN
-#define	INIT_STRING	"CFMT OFF,BYTE,BIN;CHDR OFF;CORD HI;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	INIT_STRING	"CHDR OFF;CORD HI;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	HOST_CORD	CORD_HIFIRST
 #else
-#define	INIT_STRING	"CFMT OFF,BYTE,BIN;CHDR OFF;CORD LO;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	INIT_STRING	"CHDR OFF;CORD LO;WFSU SP,0,NP,0,FP,0,SN,0"
+#define	HOST_CORD	CORD_LOFIRST
 #endif
 
 #else
 #error "Need to figure out byte order!"
 #endif
 
+/* waveform transfer format, value is bytes per sample, same as in LeCroy_DevSup.h */
+#define	LECROY_FMT_BYTE		1	/* 8 bits, default */
+#define	LECROY_FMT_WORD		2	/* up to 16 bits, for scopes with more than 8 bits resolution */
+#define	CFMT_BYTE_STRING	"CFMT OFF,BYTE,BIN"
+#define	CFMT_WORD_STRING	"CFMT OFF,WORD,BIN"
+
+/* service request on new acquisition: INR bit 0 (new signal acquired) sets */
+/* INB, bit 0 of status byte. INR? clears it, so next acquisition asks again */
+#define	SRQ_ON_STRING		"INE 1;*SRE 1"
+#define	SRQ_OFF_STRING		"*SRE 0;INE 0"
+#define	SRQ_REARM_STRING	"INR?"
+
 /* Command to query template */
 #define TMPL_STRING	"TMPL?"
-/* template we supported, acturally we can support LECROY_2_X, X=1,2,3 */
-#define	TEMPLATE	"LECROY_2_3"
+/* templates we support, LECROY_2_1, LECROY_2_2 and LECROY_2_3 share WAVEDESC layout */
+#define	TEMPLATE	"LECROY_2_"
 
 /* Command to query model */
 #define IDN_STRING	"*IDN?"
@@ -151,6 +181,12 @@
 #define	CHNLSTAT_STRING_4	"C1:TRA?;C2:TRA?;C3:TRA?;C4:TRA?;TA:TRA?;TB:TRA?;TC:TRA?;TD:TRA?"
 /* for 2 channels scope */
 #define	CHNLSTAT_STRING_2	"C1:TRA?;C2:TRA?;TA:TRA?;TB:TRA?"
+/* Command to query whole status for LeCroy_Get_Status in one round trip, */
+/* responses come back in this order, separated by ';' */
+#define	STATUS_STRING_4	"C1:TRA?;C2:TRA?;C3:TRA?;C4:TRA?;C1:VDIV?;C2:VDIV?;C3:VDIV?;C4:VDIV?;MSIZ?;TDIV?;TRMD?;TRSE?;ACAL?"
+#define	STATUS_STRING_2	"C1:TRA?;C2:TRA?;C1:VDIV?;C2:VDIV?;MSIZ?;TDIV?;TRMD?;TRSE?;ACAL?"
+/* besides channel status and volt/div, MSIZ?;TDIV?;TRMD?;TRSE?;ACAL? */
+#define	STATUS_NONCHNL_ITEMS	5
 const static char ChannelName[TOTALCHNLS][4]={"C1:","C2:","C3:","C4:","TA:","TB:","TC:","TD:"};
 
 #define	LINK_CHECK_INTERVAL	30 /* every 30 seconds check link status */
@@ -196,6 +232,11 @@ const static char ChannelName[TOTALCHNLS][4]={"C1:","C2:","C3:","C4:","TA:","TB:
 #define	ENABLEACAL	17
 #define	DISABLEACAL	18
 #define	GETACALSTAT	19
+#define	SETFORMAT	20	/* LECROY_FMT_BYTE or LECROY_FMT_WORD, see LeCroy_Set_Format */
+#define	GETFORMAT	21
+#define	ENABLESRQ	22	/* service request on new acquisition, see LeCroy_Wait_Srq */
+#define	DISABLESRQ	23
+#define	GETSRQSTAT	24
 /* To support new_command, you have to add new definition above */
 
 
@@ -246,12 +287,14 @@ static struct TRIG_MODE
 							
 /* To support new_command, you might want to add new structure here */
 
+/* WAVEDESC fields we use, in host byte order. Scope sends a 346 bytes block, */
+/* same layout for LECROY_2_1, LECROY_2_2 and LECROY_2_3 (X-Stream too), with */
+/* byte order of COMM_ORDER. LeCroy_Decode_Desc picks these out of it by the  */
+/* offset table in LeCroy_drv.c, to add a field add it here and there        */
 struct WAVEDESC
 {
-	UINT8			DESCRIPTOR_NAME[16];
-	UINT8			TEMPLATE_NAME[16];
-	SINT16			COMM_TYPE;
-	SINT16			COMM_ORDER;
+	SINT16			COMM_TYPE;	/* 0 BYTE, 1 WORD */
+	SINT16			COMM_ORDER;	/* CORD_HIFIRST or CORD_LOFIRST */
 	SINT32			WAVE_DESCRIPTOR;
 	SINT32			USER_TEXT;
 	SINT32			RES_DESC1;
@@ -262,34 +305,18 @@ struct WAVEDESC
 	SINT32			WAVE_ARRAY_2;
 	SINT32			RES_ARRAY2;
 	SINT32			RES_ARRAY3;
-	UINT8			INSTRUMENT_NAME[16];
-	SINT32			INSTRUMENT_NUMBER;
-	UINT8			TRACE_LABEL[16];
-	SINT16			RESERVED1;
-	SINT16			RESERVED2;
 	SINT32			WAVE_ARRAY_COUNT;
 	SINT32			PNTS_PER_SCREEN;
 	SINT32			FIRST_VALID_PNT;
 	SINT32			LAST_VALID_PNT;
 	SINT32			FIRST_POINT;
 	SINT32			SPARSING_FACTOR;
-	SINT32			SEGMENT_INDEX;
-	SINT32			SUBARRAY_COUNT;
+	SINT32			SUBARRAY_COUNT;	/* segments acquired in sequence mode */
 	SINT32			SWEEP_PER_ACQ;
-	SINT16			POINTS_PER_PAIR;
-	SINT16			PAIR_OFFSET;
 	FLOAT32			VERTICAL_GAIN;
 	FLOAT32			VERTICAL_OFFSET;
-	FLOAT32			MAX_VALUE;
-	FLOAT32			MIN_VALUE;
-	SINT16			NOMINAL_BITS;
-	SINT16			NOM_SUBARRAY_COUNT;
 	FLOAT32			HORIZ_INTERVAL;
 	DOUBLE64		HORIZ_OFFSET;
-	DOUBLE64		PIXEL_OFFSET;
-	UINT8			VERTUNIT[48];
-	UINT8			HORUNIT[48];
-	FLOAT32			HORIZ_UNCERTAINTY;
 	struct	TIME_STAMP
 	{
 		DOUBLE64	seconds;
@@ -300,28 +327,115 @@ struct WAVEDESC
 		SINT16		year;
 		SINT16		unused;
 	}			TRIGGER_TIME;
-	FLOAT32			ACQ_DURATION;
-	SINT16			RECORD_TYPE;
-	SINT16			PROCESSING_DONE;
-	SINT16			RESERVED5;
-	SINT16			RIS_SWEEPS;
-	SINT16			TIMEBASE;
-	SINT16			VERT_COUPLING;
-	FLOAT32			PROBE_ATT;
-	SINT16			FIXED_VERT_GAIN;
-	SINT16			BANDWIDTH_LIMIT;
-	FLOAT32			VERTICAL_VERNIER;
-	FLOAT32			ACQ_VERT_OFFSET;
-	SINT16			WAVE_SOURCE;
-} __attribute__ ((packed)) __attribute__ (( aligned (8) ));
-/* we really need "packed", because or else compiler aligned it to 8 bytes (DOUBLE64),the size will be 360 instead of 346 */
-/* then when we read wavedesc and memcpy, some parameter will be incorrect because complier insert some junk space */
-/* we need whole structure is aligned by 8 bytes, because we will define an array of it, or else the second member of array */
-/* will have alignment problem, now size will be 352 */
-
-/* when we do memcpy, we don't wanna copy 352 bytes (sizeof), that might cause access to unauthorized memory space */
+};
+
+/* size of WAVEDESC block of LECROY_2_x, WAVE_DESCRIPTOR says if there is more */
 #define	REALDESCSIZE	346
-#define EXPDDESCSIZE	352
+/* TEMPLATE_NAME and COMM_ORDER of a WAVEDESC block, we need them before decoding */
+#define	DESC_TEMPLATE_OFFSET	16
+#define	DESC_ORDER_OFFSET	34
+
+/* LeCroy_Read_Raw looks for "WAVEDESC" at most this many bytes into the response */
+#define	MAX_WF_PREFIX	64
+/* raw sample buffer is aligned like this, so conversion can use wide loads */
+#define	RAW_ALIGN	64
+/* worst case bytes per sample, WORD format */
+#define	MAX_SAMPLE_SIZE	2
+
+/* LeCroy_Read_Raw tells caller how to convert raw samples, same as in LeCroy_DevSup.h */
+#define	ACQSTAMPSIZE	20	/* sizeof(struct TIME_STAMP)+sizeof(SINT32) */
+typedef struct LECROY_WFINFO
+{
+	int	samplesize;	/* 1 for BYTE, 2 for WORD, see COMM_TYPE */
+	int	points;		/* how many valid points are in raw buffer */
+	float	gain;		/* VERTICAL_GAIN */
+	float	offset;		/* VERTICAL_OFFSET */
+	double	t0;		/* seconds from trigger to first point, FIRST_POINT counted in */
+	double	dt;		/* seconds between points, SPARSING_FACTOR counted in */
+	unsigned char	acqstamp[ACQSTAMPSIZE];	/* TRIGGER_TIME and SWEEP_PER_ACQ, tells acquisitions apart */
+	unsigned int	setup;	/* wfsetup of scope when read, see LeCroy_Read_Multi */
+	epicsTimeStamp	trgtime;	/* TRIGGER_TIME plus offset of LeCroy_Set_TrgOffset */
+	int	segments;	/* segments in raw buffer, 1 unless LeCroy_Read_Seg read a sequence */
+	int	segpoints;	/* points of each of them */
+	int	points2;	/* valid points of WAVE_ARRAY_2, if LeCroy_Read_Arrays asked for it */
+}	LECROY_WFINFO;
+
+/* one entry of TRIGTIME_ARRAY of a sequence, same as in LeCroy_DevSup.h */
+typedef struct LECROY_SEGTIME
+{
+	double	trgtime;	/* seconds from trigger of first segment */
+	double	trgoffset;	/* seconds from trigger to first point of this segment */
+}	LECROY_SEGTIME;
+
+/* LeCroy_Convert_Stat works these out in the same pass as volts, same as in LeCroy_DevSup.h */
+typedef struct LECROY_WFSTAT
+{
+	double	min;		/* volts */
+	double	max;		/* volts */
+	double	mean;		/* volts */
+	double	rms;		/* volts */
+	double	area;		/* volt seconds, sum of points times dt */
+	int	peak;		/* point of largest magnitude, first one */
+	int	points;		/* they come from */
+}	LECROY_WFSTAT;
+
+/* what LeCroy_Read_Arrays keeps beside WAVE_ARRAY_1, same as in LeCroy_DevSup.h */
+typedef struct LECROY_ARRAYS
+{
+	int	seq;		/* TRUE to read all segments of a sequence, like LeCroy_Read_Seg */
+	LECROY_SEGTIME	*psegtime;	/* TRIGTIME_ARRAY goes here if not NULL */
+	int	maxseg;		/* up to this many entries */
+	double	*prisoffset;	/* RIS_TIME_ARRAY goes here if not NULL, seconds of each RIS segment */
+	int	maxris;		/* up to this many entries */
+	int	ris;		/* returns entries of RIS_TIME_ARRAY kept */
+	void	*praw2;		/* WAVE_ARRAY_2 goes here if not NULL, same sample size as praw */
+	int	pts2;		/* up to this many samples */
+	int	points2;	/* returns samples of WAVE_ARRAY_2 kept */
+}	LECROY_ARRAYS;
+
+/* LeCroy_Get_Status fills all of it with one query, same as in LeCroy_DevSup.h */
+#define	STATUS_CHNLS	4	/* C1~C4, a two channels scope only fills first two */
+typedef struct LECROY_STATUS
+{
+	int	chanstat[STATUS_CHNLS];	/* ON or OFF, as GETCHANSTAT */
+	float	voltdiv[STATUS_CHNLS];	/* as GETVOLTDIV */
+	int	memsize;		/* as GETMEMSIZE */
+	float	timediv;		/* as GETTIMEDIV */
+	int	trgmode;		/* as GETTRGMODE */
+	int	trgsrc;			/* as GETTRGSRC */
+	int	acalstat;		/* ON or OFF, as GETACALSTAT */
+}	LECROY_STATUS;
+
+/* WFSU of one channel, LeCroy_Set_Wfsu keeps it, same as in LeCroy_DevSup.h */
+#define	WFSU_AUTO	-1
+typedef struct LECROY_WFSU
+{
+	int	sparsing;	/* SP, 0 means every point, WFSU_AUTO means pts points cover whole trace */
+	int	npoints;	/* NP, 0 means all, WFSU_AUTO means pts of the read */
+	int	firstpoint;	/* FP */
+}	LECROY_WFSU;
+
+/* traffic counters, LeCroy_Get_Stats copies them, same as in LeCroy_DevSup.h */
+typedef struct LECROY_STATS
+{
+	unsigned int	waveforms;	/* waveforms read */
+	double		wfbytes;	/* bytes of WAVE_ARRAY_1 in them, twice as much for WORD */
+	double		rxbytes;	/* all bytes from socket, headers and descriptors included */
+	unsigned int	checks;		/* channels asked for WF? DESC before transfer */
+	unsigned int	skipped;	/* of them, transfers saved because scope had nothing new */
+	unsigned int	srqs;		/* service requests, one for each new acquisition */
+}	LECROY_STATS;
+
+/* one command or query of LeCroy_Operate_Batch */
+typedef struct LECROY_OP
+{
+	char		* pCmd;		/* command to send, filled by caller */
+	BOOL		query;		/* TRUE if scope answers it, filled by caller */
+	unsigned char	seqnum;		/* VICP sequence number it went out with */
+	BOOL		done;		/* sent, and answered if it is a query */
+	char		* prdbk;	/* response, points into receive arena, don't free it */
+	int		rdbksize;	/* size of response */
+}	LECROY_OP;
 
 typedef struct LECROY
 {
@@ -338,6 +452,17 @@ typedef struct LECROY
 	int		remoteEnable;	/* Show REMOTE on LCD of scope */
 	int		lockFP;		/* Lockout front panel */
 	int		lastSeqNum;	/* 1 ~ 255 for V1a, 0 for V1, we can always send non-zero */
+	BOOL		nopipe;		/* scope doesn't stamp responses with their command, see LeCroy_Read_Header */
+	int		format;		/* LECROY_FMT_BYTE or LECROY_FMT_WORD, LeCroy_Init sends it */
+	LECROY_STATS	stats;		/* protected by semLecroy */
+	LECROY_WFSU	wfsu[TOTALCHNLS];	/* what user wants for each channel, protected by semLecroy */
+	LECROY_WFSU	wfsusent;	/* what scope has now, INIT_STRING sets all 0 */
+	unsigned int	wfsetup;	/* bumped when WFSU or format changes, so same acquisition reads different */
+	BOOL		srqenable;	/* ENABLESRQ, LeCroy_Init sends it again after link recovery */
+	epicsEventId	srqEvent;	/* signaled when scope asserts SRQ, see LeCroy_Take_Srq */
+	BOOL		srqtaken;	/* set with srqEvent, LeCroy_Wait_Srq clears it, see LeCroy_Get_SrqFd */
+	BOOL		resparsing;	/* reading again what auto sparsing got wrong, see LeCroy_Auto_Sparsing */
+	double		trgoffset;	/* seconds from scope clock to IOC clock, protected by semLecroy */
 
         epicsMutexId    semOp;  	/* to protect access to WAVEDESC structure and LeCroyModel */
 	int		VICP_Version;	/* So far the version in header is always 1 */
@@ -345,11 +470,30 @@ typedef struct LECROY
 	char		LeCroyModel[MAX_CA_STRING_SIZE];
 	char		chanenbl[TOTALCHNLS];
 	struct WAVEDESC	channel_desc[TOTALCHNLS];
+
+	char		* prcvbuf;	/* receive arena, reused by every transaction, protected by semLecroy */
+	unsigned int	rcvbufsize;	/* current size of receive arena, only grows */
+
+	char		* prxring;	/* read-ahead buffer of socket, protected by semLecroy */
+	unsigned int	rxpos;		/* next byte in read-ahead buffer we haven't consumed */
+	unsigned int	rxlen;		/* valid bytes in read-ahead buffer */
+	unsigned int	rcvtoutsec;	/* SO_RCVTIMEO we set on sFd, 0 if socket can't do it */
+
+	unsigned int	blkremain;	/* bytes not read yet in current VICP block of a streamed response */
+	BOOL		blkeoi;		/* current VICP block is the last one of the response */
+	unsigned char	blkseq;		/* sequence number of the command a streamed response belongs to */
 }	* LeCroyID;			/* it is not necessary to say packed here, cause we access all member by name */
 
 /* Here we define something in communication header */
 #define	COMM_HDR_SIZE		8
 
+/* Block size is big-endian in byte 4~7 no matter what CORD says, */
+/* assemble it byte by byte because long is 8 bytes on 64 bits host */
+#define	COMM_HDR_GET_SIZE(h)	( ((unsigned int)(h)[4]<<24) | ((unsigned int)(h)[5]<<16) \
+				| ((unsigned int)(h)[6]<<8) | (unsigned int)(h)[7] )
+#define	COMM_HDR_SET_SIZE(h,n)	do { (h)[4]=((n)>>24)&0xFF; (h)[5]=((n)>>16)&0xFF; \
+				     (h)[6]=((n)>>8)&0xFF; (h)[7]=(n)&0xFF; } while(0)
+
 /* First byte of header */
 #define	COMM_HDR_OPER_DATA	0x80
 #define	COMM_HDR_OPER_REMOTE	0x40
@@ -363,6 +507,9 @@ typedef struct LECROY
 /* Second byte of header */
 #define COMM_HDR_VER_1		0x01
 
+/* Third byte of header, sequence number of v1a, we use 1~255 and wrap, 0 means v1 */
+#define	COMM_HDR_SEQ_MAX	255
+
 /* Revision, we are not using string to avoid mutex issue */
 #define	COMM_HDR_REV_0		'0'
 #define	COMM_HDR_REV_A		'a'
@@ -398,6 +545,14 @@ typedef struct LECROY
 #define	LECROY_ERR_IOCTL_UNSUPPORTED_CMD	27
 #define	LECROY_ERR_IOCTL_MISUSE_CHNL_ZERO	28
 #define	LECROY_ERR_LASTTRGTIME_CHNLNUM_ERR	29
+#define	LECROY_ERR_READWF_BAD_DESC		30
+#define	LECROY_ERR_RESPONSE_OUT_OF_SEQ		31
+#define	LECROY_ERR_STATUS_PARSE_ERR		32
+#define	LECROY_ERR_READWF_MIXED_TRIGGER		33
+#define	LECROY_ERR_WRONG_FORMAT			34
+#define	LECROY_ERR_WRONG_WFSU			35
+#define	LECROY_ERR_SRQ_TIMEOUT			36
+#define	LECROY_ERR_READWF_SPARSING		37
 /* To add new_command or new_function, you might want more error numner */
 
 const static char Error_Msg[50][256]=
@@ -431,7 +586,15 @@ const static char Error_Msg[50][256]=
 	/*26*/	"Nvmem index is illegal in LeCroy_Ioctl\n",
 	/*27*/	"Unsupported command in LeCroy_Ioctl\n",
 	/*28*/	"Try to use channel number 0 for channel related operation in LeCroy_Ioctl\n",
-	/*29*/	"Channel number is out of range in LeCroy_Get_LastTrgTime!\n"
+	/*29*/	"Channel number is out of range in LeCroy_Get_LastTrgTime!\n",
+	/*30*/	"WAVEDESC is missing or doesn't match the waveform that follows in LeCroy_Read_Raw!\n",
+	/*31*/	"Response sequence number is ahead of the one we wait for in LeCroy_Read_Response, so we force link down!\n",
+	/*32*/	"Status readback doesn't have what we asked for in LeCroy_Get_Status!\n",
+	/*33*/	"Channels come from different triggers in LeCroy_Read_Multi, we drop the late ones!\n",
+	/*34*/	"Transfer format must be LECROY_FMT_BYTE or LECROY_FMT_WORD in LeCroy_Set_Format!\n",
+	/*35*/	"Channel number or WFSU setting is out of range in LeCroy_Set_Wfsu!\n",
+	/*36*/	"No service request from scope in LeCroy_Wait_Srq, link down or SRQ not enabled?\n",
+	/*37*/	"Auto sparsing is still wrong after reading waveform again, timebase changed meanwhile?\n"
 /* To add new_command or new_function, you might want more error message */
 };
 #ifndef min
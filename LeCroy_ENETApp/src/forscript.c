@@ -1 +1 @@
-void init_LT364(int num, char* ipaddr);
+void init_LT364(int num, char* ipaddr, int format);
@@ -62,6 +62,7 @@ LeCroy_ENETTest_registerRecordDeviceDriver(pdbbase)
 # ----------------------------------------------------------------------
 LECROY_DRV_DEBUG=1
 #install and init LT364 scope driver
+#var lecroyPoolThreads 8  # workers for all scopes, default is 2 per core
 init_LT364(0, "160.91.229.165")
 #init_LT364(1, "130.199.2.165")
 #init_LT364(2, "130.199.2.166")